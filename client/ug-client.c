@@ -19,7 +19,22 @@
  *
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <dlfcn.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
 #include <appcore-efl.h>
 #include <ui-gadget.h>
 #include <Ecore_X.h>
@@ -40,8 +55,10 @@ static void prt_usage(const char *cmd)
 {
 	fprintf(stderr, "Usage: %s [-f] [-F] -n <UG NAME> [-d <Arguments>]\n",
 		cmd);
+	fprintf(stderr, "       %s -S\n", cmd);
 	fprintf(stderr, "   Options:\n");
 	fprintf(stderr, "            -d argument\n");
+	fprintf(stderr, "            -S Run as pre-initialized launch server\n");
 	fprintf(stderr, "            -F Fullview mode (Default)\n");
 	fprintf(stderr, "            -f Frameview mode\n");
 	fprintf(stderr, "   Example:\n");
@@ -337,7 +354,7 @@ static int update_argument(const char *optarg, struct appdata *ad)
 	return 0;
 }
 
-int main(int argc, char *argv[])
+static int client_main(int argc, char *argv[])
 {
 	int opt;
 	struct appdata ad;
@@ -393,3 +410,556 @@ int main(int argc, char *argv[])
 	}
 	return appcore_efl_main(PACKAGE, &argc, &argv, &ops);
 }
+
+/*
+ * request: struct server_request, with the requester's stdio passed as
+ *          SCM_RIGHTS, followed by argv, envp and cwd as NUL terminated
+ *          strings
+ * reply:   <pid_t pid> when the child runs, <int status> when it exits
+ */
+struct server_request {
+	int argc;
+	int envc;
+	int len;
+};
+
+struct server_client {
+	pid_t pid;
+	/* the exit status is sent here */
+	int conn;
+	struct server_client *next;
+};
+
+static struct server_client *server_clients;
+static int server_sigchld_fds[2] = { -1, -1 };
+static pid_t server_child_pid;
+
+/*
+ * The socket is kept in a directory which only the user can access:
+ * $XDG_RUNTIME_DIR if set, UG_SERVER_DIR<uid> otherwise.
+ */
+static int get_server_path(char *path, int len, int create)
+{
+	char dir[PATH_MAX];
+	const char *runtime_dir;
+	struct stat st;
+
+	runtime_dir = getenv("XDG_RUNTIME_DIR");
+	if (runtime_dir && *runtime_dir)
+		snprintf(dir, sizeof(dir), "%s", runtime_dir);
+	else
+		snprintf(dir, sizeof(dir), "%s%d", UG_SERVER_DIR,
+			 (int)getuid());
+
+	if (create && mkdir(dir, 0700) && errno != EEXIST)
+		return -1;
+
+	if (lstat(dir, &st))
+		return -1;
+
+	if (!S_ISDIR(st.st_mode) || st.st_uid != getuid()
+	    || (st.st_mode & 077)) {
+		LOGE("%s is not a private directory\n", dir);
+		return -1;
+	}
+
+	if (snprintf(path, len, "%s/%s", dir, UG_SERVER_SOCKET) >= len)
+		return -1;
+
+	return 0;
+}
+
+/* both ends of the socket must belong to the same user */
+static int check_peer(int fd)
+{
+	struct ucred cred;
+	socklen_t len = sizeof(cred);
+
+	if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len)
+	    || cred.uid != getuid()) {
+		LOGE("peer check failed\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+static int write_all(int fd, const void *buf, size_t len)
+{
+	const char *p = buf;
+	ssize_t r;
+
+	while (len > 0) {
+		r = write(fd, p, len);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r <= 0)
+			return -1;
+		p += r;
+		len -= r;
+	}
+
+	return 0;
+}
+
+static int read_all(int fd, void *buf, size_t len)
+{
+	char *p = buf;
+	ssize_t r;
+
+	while (len > 0) {
+		r = read(fd, p, len);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r <= 0)
+			return -1;
+		p += r;
+		len -= r;
+	}
+
+	return 0;
+}
+
+static int send_request(int fd, struct server_request *req)
+{
+	struct msghdr msg = { 0, };
+	struct iovec iov;
+	struct cmsghdr *cmsg;
+	char ctl[CMSG_SPACE(sizeof(int) * 3)];
+	int fds[3] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+	ssize_t r;
+
+	iov.iov_base = req;
+	iov.iov_len = sizeof(*req);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = ctl;
+	msg.msg_controllen = sizeof(ctl);
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+	memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+	do {
+		r = sendmsg(fd, &msg, 0);
+	} while (r < 0 && errno == EINTR);
+
+	return r == sizeof(*req) ? 0 : -1;
+}
+
+static int recv_request(int fd, struct server_request *req, int *fds)
+{
+	struct msghdr msg = { 0, };
+	struct iovec iov;
+	struct cmsghdr *cmsg;
+	char ctl[CMSG_SPACE(sizeof(int) * 3)];
+	ssize_t r;
+
+	iov.iov_base = req;
+	iov.iov_len = sizeof(*req);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = ctl;
+	msg.msg_controllen = sizeof(ctl);
+
+	do {
+		r = recvmsg(fd, &msg, 0);
+	} while (r < 0 && errno == EINTR);
+
+	if (r != sizeof(*req) || (msg.msg_flags & MSG_CTRUNC))
+		return -1;
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	if (!cmsg || cmsg->cmsg_level != SOL_SOCKET
+	    || cmsg->cmsg_type != SCM_RIGHTS
+	    || cmsg->cmsg_len != CMSG_LEN(sizeof(int) * 3))
+		return -1;
+
+	memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * 3);
+	return 0;
+}
+
+static void server_forward_signal(int sig)
+{
+	if (server_child_pid > 0)
+		kill(server_child_pid, sig);
+}
+
+/* returns 0 with the exit status of the launched child */
+static int server_request(int argc, char *argv[], int *status)
+{
+	struct sockaddr_un addr = { 0, };
+	struct server_request req;
+	char cwd[PATH_MAX];
+	char *buf;
+	char *p;
+	int len = 0;
+	int fd;
+	int i;
+	int st;
+	pid_t pid;
+
+	addr.sun_family = AF_UNIX;
+	if (get_server_path(addr.sun_path, sizeof(addr.sun_path), 0))
+		return -1;
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -1;
+
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr))
+	    || check_peer(fd)) {
+		close(fd);
+		return -1;
+	}
+
+	if (!getcwd(cwd, sizeof(cwd)))
+		cwd[0] = '\0';
+
+	req.argc = argc;
+	for (req.envc = 0; environ[req.envc]; req.envc++)
+		len += strlen(environ[req.envc]) + 1;
+	for (i = 0; i < argc; i++)
+		len += strlen(argv[i]) + 1;
+	len += strlen(cwd) + 1;
+
+	if (len > UG_SERVER_REQUEST_MAX) {
+		close(fd);
+		return -1;
+	}
+
+	buf = malloc(len);
+	if (!buf) {
+		close(fd);
+		return -1;
+	}
+
+	p = buf;
+	for (i = 0; i < argc; i++)
+		p = stpcpy(p, argv[i]) + 1;
+	for (i = 0; i < req.envc; i++)
+		p = stpcpy(p, environ[i]) + 1;
+	strcpy(p, cwd);
+	req.len = len;
+
+	if (send_request(fd, &req) || write_all(fd, buf, len)
+	    || read_all(fd, &pid, sizeof(pid)) || pid <= 0) {
+		free(buf);
+		close(fd);
+		return -1;
+	}
+
+	free(buf);
+	LOGD("launched by server: pid %d\n", pid);
+
+	/* the child is in its own session, pass termination on */
+	server_child_pid = pid;
+	signal(SIGINT, server_forward_signal);
+	signal(SIGTERM, server_forward_signal);
+	signal(SIGHUP, server_forward_signal);
+
+	if (read_all(fd, &st, sizeof(st))) {
+		LOGE("lost the launch server, pid %d\n", pid);
+		*status = EXIT_FAILURE;
+	} else if (WIFSIGNALED(st)) {
+		*status = 128 + WTERMSIG(st);
+	} else {
+		*status = WEXITSTATUS(st);
+	}
+
+	close(fd);
+	return 0;
+}
+
+static int server_child(int conn)
+{
+	struct server_request req;
+	char **strv;
+	char **argv;
+	char *buf;
+	char *p;
+	int fds[3];
+	int n;
+	int i;
+	pid_t pid;
+
+	if (recv_request(conn, &req, fds))
+		return -1;
+
+	if (req.argc <= 0 || req.envc < 0 || req.len <= 0
+	    || req.len > UG_SERVER_REQUEST_MAX)
+		return -1;
+
+	buf = malloc(req.len + 1);
+	if (!buf || read_all(conn, buf, req.len))
+		return -1;
+	buf[req.len] = '\0';
+
+	/* argv, envp and cwd */
+	n = req.argc + req.envc + 1;
+	strv = calloc(n, sizeof(char *));
+	argv = calloc(req.argc + 1, sizeof(char *));
+	if (!strv || !argv)
+		return -1;
+
+	for (i = 0, p = buf; i < n; i++) {
+		if (p >= buf + req.len)
+			return -1;
+		strv[i] = p;
+		p += strlen(p) + 1;
+	}
+	memcpy(argv, strv, req.argc * sizeof(char *));
+
+	/* move the fds out of the way first, they could be 0, 1 or 2 */
+	for (i = 0; i < 3; i++) {
+		n = fcntl(fds[i], F_DUPFD, STDERR_FILENO + 1);
+		close(fds[i]);
+		fds[i] = n;
+	}
+	for (i = 0; i < 3; i++) {
+		if (fds[i] < 0)
+			continue;
+		dup2(fds[i], i);
+		close(fds[i]);
+	}
+
+	clearenv();
+	for (i = 0; i < req.envc; i++)
+		putenv(strv[req.argc + i]);
+
+	p = strv[req.argc + req.envc];
+	if (*p && chdir(p))
+		LOGE("chdir %s failed: %s\n", p, strerror(errno));
+
+	pid = getpid();
+	write_all(conn, &pid, sizeof(pid));
+	close(conn);
+
+	setsid();
+
+	return client_main(req.argc, argv);
+}
+
+static void server_sigchld(int sig)
+{
+	int err = errno;
+
+	if (write(server_sigchld_fds[1], "", 1) < 0) {
+		/* the pipe is full, a wakeup is pending anyway */
+	}
+	errno = err;
+}
+
+/* sends the exit status of finished children to their requesters */
+static void server_reap(void)
+{
+	struct server_client **c;
+	struct server_client *done;
+	char drain[64];
+	int status;
+	pid_t pid;
+
+	while (read(server_sigchld_fds[0], drain, sizeof(drain)) > 0)
+		;
+
+	while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+		for (c = &server_clients; *c; c = &(*c)->next) {
+			if ((*c)->pid != pid)
+				continue;
+			done = *c;
+			*c = done->next;
+			/* the requester may be gone already */
+			write_all(done->conn, &status, sizeof(status));
+			close(done->conn);
+			free(done);
+			break;
+		}
+	}
+}
+
+static int server_setup_signals(void)
+{
+	struct sigaction sa;
+	int i;
+
+	if (pipe(server_sigchld_fds))
+		return -1;
+
+	for (i = 0; i < 2; i++) {
+		fcntl(server_sigchld_fds[i], F_SETFL, O_NONBLOCK);
+		fcntl(server_sigchld_fds[i], F_SETFD, FD_CLOEXEC);
+	}
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = server_sigchld;
+	sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+	sigemptyset(&sa.sa_mask);
+	if (sigaction(SIGCHLD, &sa, NULL))
+		return -1;
+
+	/* a requester which went away must not take the server down */
+	signal(SIGPIPE, SIG_IGN);
+
+	return 0;
+}
+
+/* runs in the forked child, drops what belongs to the server */
+static void server_fork_reset(int fd)
+{
+	struct server_client *c;
+
+	signal(SIGCHLD, SIG_DFL);
+	signal(SIGPIPE, SIG_DFL);
+
+	/* main loop internals must not be shared with the server */
+	ecore_fork_reset();
+
+	close(fd);
+	close(server_sigchld_fds[0]);
+	close(server_sigchld_fds[1]);
+
+	while ((c = server_clients)) {
+		server_clients = c->next;
+		close(c->conn);
+		free(c);
+	}
+}
+
+static int server_main(int argc, char *argv[])
+{
+	struct sockaddr_un addr = { 0, };
+	struct server_client *client;
+	struct pollfd pfd[2];
+	Eina_List *groups;
+	int fd;
+	int conn;
+	pid_t pid;
+
+	setenv("ELM_ENGINE", "gl", 1);
+
+	/*
+	 * Everything which does not need the display connection is done
+	 * before fork: EFL modules and config, the client theme, and
+	 * the effect engine. The children only connect to the display
+	 * and load the UI gadget module.
+	 */
+	elm_quicklaunch_init(argc, argv);
+
+	groups = edje_file_collection_list(EDJ_FILE);
+	if (groups)
+		edje_file_collection_list_free(groups);
+
+	if (!dlopen(UG_ENGINE_FILE, RTLD_LAZY))
+		LOGE("engine preloading failed: %s\n", dlerror());
+
+	addr.sun_family = AF_UNIX;
+	if (get_server_path(addr.sun_path, sizeof(addr.sun_path), 1)) {
+		LOGE("server setup failed: no socket directory\n");
+		return -1;
+	}
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		LOGE("socket failed: %s\n", strerror(errno));
+		return -1;
+	}
+
+	unlink(addr.sun_path);
+
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr))
+	    || chmod(addr.sun_path, 0600) || listen(fd, 16)
+	    || server_setup_signals()) {
+		LOGE("server setup failed: %s\n", strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	pfd[0].fd = fd;
+	pfd[0].events = POLLIN;
+	pfd[1].fd = server_sigchld_fds[0];
+	pfd[1].events = POLLIN;
+
+	while (1) {
+		if (poll(pfd, 2, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			LOGE("poll failed: %s\n", strerror(errno));
+			break;
+		}
+
+		if (pfd[1].revents)
+			server_reap();
+
+		if (!(pfd[0].revents & POLLIN))
+			continue;
+
+		conn = accept(fd, NULL, NULL);
+		if (conn < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			LOGE("accept failed: %s\n", strerror(errno));
+			break;
+		}
+
+		client = calloc(1, sizeof(struct server_client));
+		if (!client || check_peer(conn)) {
+			free(client);
+			close(conn);
+			continue;
+		}
+
+		pid = fork();
+		if (pid == 0) {
+			free(client);
+			server_fork_reset(fd);
+			return server_child(conn);
+		}
+		if (pid < 0) {
+			LOGE("fork failed: %s\n", strerror(errno));
+			free(client);
+			close(conn);
+			continue;
+		}
+
+		/* reaped on the next SIGCHLD, even if it is gone already */
+		client->pid = pid;
+		client->conn = conn;
+		client->next = server_clients;
+		server_clients = client;
+	}
+
+	close(fd);
+	unlink(addr.sun_path);
+	return -1;
+}
+
+static int is_server_mode(int argc, char *argv[])
+{
+	int i;
+
+	for (i = 1; i < argc; i++)
+		if (!strcmp(argv[i], "-S"))
+			return 1;
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int cmdlen;
+	int status;
+
+	cmdlen = strlen(argv[0]);
+	if (strncmp(argv[0], "ug-launcher", cmdlen) == 0
+		|| strncmp(argv[0], "/usr/bin/ug-launcher", cmdlen) == 0) {
+		if (is_server_mode(argc, argv))
+			return server_main(argc, argv);
+		/* hand the request over to the launch server if it runs */
+		if (!server_request(argc, argv, &status))
+			return status;
+	}
+
+	return client_main(argc, argv);
+}
@@ -41,6 +41,12 @@
 #define EDJ_FILE EDJDIR "/" PACKAGE ".edj"
 #define GRP_MAIN "main"
 
+/* pre-initialized launch server (ug-launcher -S) */
+#define UG_SERVER_DIR "/tmp/.ug-launcher-"
+#define UG_SERVER_SOCKET "ug-launcher-server"
+#define UG_SERVER_REQUEST_MAX 65536
+#define UG_ENGINE_FILE "/usr/lib/libui-gadget-1-efl-engine.so"
+
 struct appdata {
 	Evas_Object *win;
 	Evas_Object *ly_main;
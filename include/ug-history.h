@@ -0,0 +1,33 @@
+/*
+ *  UI Gadget
+ *
+ * Copyright (c) 2000 - 2011 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * Contact: Jayoun Lee <airjany@samsung.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#ifndef __UG_HISTORY_H__
+#define __UG_HISTORY_H__
+
+void ug_history_load(void);
+void ug_history_save(void);
+void ug_history_launch(const char *name, int delay);
+int ug_history_top(const char **names, int max);
+void ug_history_transition(const char *parent, const char *child);
+const char *ug_history_predict(const char *parent);
+
+#endif				/* __UG_HISTORY_H__ */
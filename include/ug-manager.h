@@ -31,6 +31,27 @@ ui_gadget_h ugman_ug_load(ui_gadget_h parent,
 				enum ug_mode mode,
 				service_h service,
 				struct ug_cbs *cbs);
+ug_preload_h ugman_preload(const char *name);
+int ugman_preload_release(ug_preload_h preload);
+int ugman_preload_list(const char **names, ug_preload_h *preloads, int n,
+		       void (*done_cb) (void *priv), void *priv);
+ui_gadget_h ugman_ug_load_preloaded(ui_gadget_h parent,
+				ug_preload_h preload,
+				enum ug_mode mode,
+				service_h service,
+				struct ug_cbs *cbs);
+ui_gadget_h ugman_ug_load_async(ui_gadget_h parent,
+				const char *name,
+				enum ug_mode mode,
+				service_h service,
+				struct ug_cbs *cbs,
+				void (*done_cb) (ui_gadget_h ug, void *priv));
+ui_gadget_h ugman_ug_prepare(ui_gadget_h parent,
+				const char *name,
+				enum ug_mode mode,
+				service_h service);
+int ugman_ug_show_prepared(ui_gadget_h ug, struct ug_cbs *cbs);
+int ugman_set_prediction(int enable);
 int ugman_ug_del(ui_gadget_h ug);
 int ugman_ug_del_all(void);
 
@@ -42,6 +63,7 @@ int ugman_send_key_event(enum ug_key_event event);
 int ugman_send_message(ui_gadget_h ug, service_h msg);
 
 void *ugman_get_window(void);
+int ugman_get_fullview_depth(void);
 
 int ugman_ug_exist(ui_gadget_h ug);
 
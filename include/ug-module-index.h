@@ -0,0 +1,41 @@
+/*
+ *  UI Gadget
+ *
+ * Copyright (c) 2000 - 2011 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * Contact: Jayoun Lee <airjany@samsung.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#ifndef __UG_MODULE_INDEX_H__
+#define __UG_MODULE_INDEX_H__
+
+#include <linux/limits.h>
+
+#define UG_MODULE_DIR_MAX 4
+
+struct ug_module_dirs_stamp {
+	int count;
+	long mtime[UG_MODULE_DIR_MAX][2];
+};
+
+int ug_module_dirs_get(char dirs[][PATH_MAX], int max);
+void ug_module_dirs_stamp_get(struct ug_module_dirs_stamp *stamp);
+
+int ug_module_index_lookup(const char *name, char *path, int len);
+void ug_module_index_invalidate(void);
+
+#endif				/* __UG_MODULE_INDEX_H__ */
@@ -0,0 +1,50 @@
+/*
+ *  UI Gadget
+ *
+ * Copyright (c) 2000 - 2011 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * Contact: Jayoun Lee <airjany@samsung.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#ifndef __UG_MODULE_MANIFEST_H__
+#define __UG_MODULE_MANIFEST_H__
+
+#include "ui-gadget.h"
+
+/*
+ * Optional libug-<name>.manifest next to the module, e.g.
+ *
+ *   [UG]
+ *   Indicator=portrait
+ *   Memory=2048
+ *   Resources=/usr/ug/res/edje/ug-foo.edj;/usr/ug/res/images/bg.png
+ */
+struct ug_manifest {
+	int has_opt:1;
+	enum ug_option opt;
+	/* expected memory usage in KB, 0 if unknown */
+	int memory;
+	/* NULL terminated list, NULL if none */
+	char **resources;
+};
+
+/* returns a copy, which MUST be released with ug_module_manifest_free() */
+struct ug_manifest *ug_module_manifest_get(const char *name);
+void ug_module_manifest_free(struct ug_manifest *manifest);
+void ug_module_manifest_flush(void);
+
+#endif				/* __UG_MODULE_MANIFEST_H__ */
@@ -28,9 +28,25 @@ struct ug_module {
 	void *handle;
 	const char *module_name;
 	struct ug_module_ops ops;
+	int (*init) (struct ug_module_ops *ops);
+	void (*exit) (struct ug_module_ops *ops);
+	int initted:1;
+	/* usec spent in the loading phases, up to UG_TIMING_INIT */
+	int timing[UG_TIMING_MAX];
 };
 
+int ug_module_register(const char *name,
+			int (*init) (struct ug_module_ops *ops),
+			void (*exit) (struct ug_module_ops *ops));
+int ug_module_path_get(const char *name, char *path, int len);
+int ug_module_exist(const char *name);
+int ug_module_cached(const char *name);
+struct ug_module *ug_module_open(const char *name);
+int ug_module_init(struct ug_module *module);
 struct ug_module *ug_module_load(const char *name);
 int ug_module_unload(struct ug_module *module);
+void ug_module_drop(struct ug_module *module);
+void ug_module_cache_flush(void);
+void ug_module_teardown_flush(void);
 
 #endif				/* __UG_MODULE_H__ */
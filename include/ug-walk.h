@@ -0,0 +1,85 @@
+/*
+ *  UI Gadget
+ *
+ * Copyright (c) 2000 - 2011 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * Contact: Jayoun Lee <airjany@samsung.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#ifndef __UG_WALK_H__
+#define __UG_WALK_H__
+
+#include "ug.h"
+
+enum ug_walk_ret {
+	UG_WALK_CONTINUE = 0x00,
+	/* neither the children nor the post callback of the node */
+	UG_WALK_SKIP,
+};
+
+/*
+ * Visits the subtree of top without recursion: pre callback on the way
+ * down, post callback after all the children. The tree links give the
+ * way back up, so no stack is needed. The post callback may unlink and
+ * free its node, and nodes linked during the walk are not visited.
+ * depth is 0 for top.
+ */
+static inline void ug_walk(ui_gadget_h top,
+			   enum ug_walk_ret (*pre) (ui_gadget_h ug, int depth,
+						    void *data),
+			   void (*post) (ui_gadget_h ug, int depth, void *data),
+			   void *data)
+{
+	ui_gadget_h ug = top;
+	ui_gadget_h next;
+	ui_gadget_h parent;
+	int depth = 0;
+	int visit;
+
+	while (ug) {
+		visit = !pre || pre(ug, depth, data) == UG_WALK_CONTINUE;
+		if (visit && ug->first_child) {
+			ug = ug->first_child;
+			depth++;
+			continue;
+		}
+
+		for (;;) {
+			if (ug == top) {
+				if (visit && post)
+					post(ug, depth, data);
+				return;
+			}
+
+			next = ug->next_sibling;
+			parent = ug->parent;
+			if (visit && post)
+				post(ug, depth, data);
+
+			if (next) {
+				ug = next;
+				break;
+			}
+
+			ug = parent;
+			depth--;
+			visit = 1;
+		}
+	}
+}
+
+#endif				/* __UG_WALK_H__ */
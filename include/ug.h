@@ -22,6 +22,7 @@
 #ifndef __UG_H__
 #define __UG_H__
 
+#include <glib.h>
 #include <bundle.h>
 #include "ug-module.h"
 #include "ui-gadget.h"
@@ -30,6 +31,7 @@ struct ug_child;
 
 enum ug_state {
 	UG_STATE_READY = 0x00,
+	UG_STATE_PREPARED,
 	UG_STATE_CREATED,
 	UG_STATE_RUNNING,
 	UG_STATE_STOPPED,
@@ -51,26 +53,52 @@ enum ug_layout_state {
 };
 
 struct ui_gadget_s {
-	const char *name;
-	void *layout;
+	/* hot: tree walks and handle checks */
 	enum ug_state state;
 	enum ug_mode mode;
 	enum ug_option opt;
+	int destroy_me:1;
 
 	ui_gadget_h parent;
-	void *children;
+	/* children are linked through the siblings, the latest first */
+	ui_gadget_h first_child;
+	ui_gadget_h next_sibling;
+	ui_gadget_h prev_sibling;
+	/* fullview stack, fv_prev is the one above */
+	ui_gadget_h fv_prev;
+	ui_gadget_h fv_next;
 
 	struct ug_module *module;
+
+	/* cold: creation, layout and callbacks */
+	const char *name;
+	void *layout;
 	struct ug_cbs cbs;
 
 	service_h service;
 
-	int destroy_me:1;
 	enum ug_layout_state layout_state;
 	void *effect_layout;
+
+	/* pending module loading of ug_create_async() */
+	void *load_job;
+	void *populate_job;
+	/* usec spent in each creation phase */
+	int timing[UG_TIMING_MAX];
+};
+
+struct ug_preload_s {
+	const char *name;
+	struct ug_module *module;
+	unsigned int idle_id;
+	/* pending ug_preload_list() loading */
+	struct ug_preload_job *job;
 };
 
+ui_gadget_h ug_alloc(const char *name);
 ui_gadget_h ug_root_create(void);
 int ug_free(ui_gadget_h ug);
+GThreadPool *ug_thread_pool_get(GThreadPool **pool, GFunc func,
+				int max_threads);
 
 #endif				/* __UG_H__ */
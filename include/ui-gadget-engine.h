@@ -54,8 +54,14 @@ struct ug_engine_ops {
 	void *(*create)(void *win, ui_gadget_h ug, void(*hide_end_cb)(ui_gadget_h ug));
 	/** destroy operation */
 	void (*destroy)(ui_gadget_h ug, ui_gadget_h fv_top);
+	/** prepare operation, keeps the created effect of a prepared UI gadget hidden */
+	void (*prepare)(ui_gadget_h ug);
+	/** render post operation, invokes cb once after the next frame of win is rendered. returns 0 on success */
+	int (*render_post)(void *win, void (*cb)(void *data), void *data);
+	/** prefetch operation, warms up the toolkit's cache with a resource file of a UI gadget before it is created asynchronously */
+	void (*prefetch)(const char *file);
 	/** reserved operations */
-	void *reserved[4];
+	void *reserved[1];
 };
 
 #ifdef __cplusplus
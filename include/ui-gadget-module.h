@@ -70,16 +70,42 @@ struct ug_module_ops {
 					service_h service, void *priv);
 	/** destroying operation */
 	void (*destroying) (ui_gadget_h ug, service_h service, void *priv);
+	/**
+	 * prepare operation, optional. Invoked before the create operation,
+	 * for I/O heavy setup which create could use through priv. It runs
+	 * on a worker thread when the UI gadget is created asynchronously,
+	 * so it must not use UI toolkit APIs. Nonzero return value fails
+	 * the creation.
+	 */
+	int (*prepare) (service_h service, void *priv);
+	/**
+	 * populate operation, optional. Invoked on the main loop after the
+	 * first frame with the layout returned by create is rendered, so
+	 * create could return a lightweight skeleton and fill in the
+	 * content here.
+	 */
+	void (*populate) (ui_gadget_h ug, service_h service, void *priv);
 	/** reserved operations */
-	void *reserved[3];
+	void *reserved[1];
 
 	/** private data */
 	void *priv;
 
 	/** option */
 	enum ug_option opt;
+
+	/**
+	 * events handled by the event operation, ORed UG_EVENT_MASK() bits.
+	 * 0 means all events
+	 */
+	unsigned int event_mask;
 };
 
+/**
+ * Bit of an event in event_mask of struct ug_module_ops
+ */
+#define UG_EVENT_MASK(event) (1U << (event))
+
 /**
  * \par Description:
  * This function makes a request that caller of the given UI gadget instance destroys the instance.
@@ -160,6 +186,60 @@ int ug_destroy_me(ui_gadget_h ug);
  */
 int ug_send_result(ui_gadget_h ug, service_h result);
 
+/**
+ * \par Description:
+ * This function registers a UI gadget module which is linked into the process
+ *
+ * \par Purpose:
+ * This function is used for providing a UI gadget without a separate libug-<name>.so. ug_create() with the registered name uses the given init and exit functions instead of loading a module file.
+ *
+ * \par Typical use case:
+ * Application developers who link frequently used UI gadgets statically could use the function, or UG_MODULE_REGISTER() macro.
+ *
+ * \par Method of function operation:
+ * The name is registered with the functions, which have the same role as UG_MODULE_INIT and UG_MODULE_EXIT of a module file. The registered module takes precedence over module files with the same name.
+ *
+ * \par Context of function:
+ * This function could be called at any time, even before ug_init()
+ *
+ * @param[in] name name of UI gadget
+ * @param[in] init init function, which fills the module operations
+ * @param[in] exit exit function, which could be NULL
+ * @return 0 on success, -1 on error
+ *
+ * \pre None
+ * \post None
+ * \see UG_MODULE_REGISTER()
+ * \remarks Registering the same name again replaces the functions.
+ *
+ * \par Sample code:
+ * \code
+ * #include <ui-gadget-module.h>
+ * ...
+ * static int hello_init(struct ug_module_ops *ops)
+ * {
+ * ...
+ * }
+ * ...
+ * ug_register_module("helloUG-efl", hello_init, hello_exit);
+ * ...
+ * \endcode
+ */
+int ug_register_module(const char *name,
+		int (*init) (struct ug_module_ops *ops),
+		void (*exit) (struct ug_module_ops *ops));
+
+/**
+ * Registers a UI gadget module at load time of the binary
+ * @see ug_register_module()
+ */
+#define UG_MODULE_REGISTER(name, init, exit) \
+	static void __attribute__ ((constructor)) \
+	__ug_module_register_##init(void) \
+	{ \
+		ug_register_module(name, init, exit); \
+	}
+
 #ifdef __cplusplus
 }
 #endif
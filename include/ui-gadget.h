@@ -69,6 +69,12 @@ extern "C" {
  */
 typedef struct ui_gadget_s *ui_gadget_h;
 
+/**
+ * struct ug_preload is an opaque type representing a preloaded UI gadget module
+ * @see ug_preload(), ug_preload_release(), ug_create_preloaded()
+ */
+typedef struct ug_preload_s *ug_preload_h;
+
 /**
  * UI gadget mode
  * @see ug_create()
@@ -109,12 +115,35 @@ enum ug_key_event {
 	UG_KEY_EVENT_MAX
 };
 
+/**
+ * UI gadget creation phase
+ * @see ug_get_timing()
+ */
+enum ug_timing {
+	UG_TIMING_RESOLVE = 0x00,	/**< Module path lookup */
+	UG_TIMING_DLOPEN,		/**< Dynamic loading of the module */
+	UG_TIMING_DLSYM,		/**< Lookup of UG_MODULE_INIT */
+	UG_TIMING_INIT,			/**< UG_MODULE_INIT */
+	UG_TIMING_CREATE,		/**< Create operation */
+	UG_TIMING_ENGINE_CREATE,	/**< Effect layout creation */
+	UG_TIMING_LAYOUT,		/**< Layout callback */
+	UG_TIMING_MAX
+};
+
 #define UG_OPT_INDICATOR_MASK (0x03)
 #define UG_OPT_INDICATOR(opt) (opt & UG_OPT_INDICATOR_MASK)
 
+/**
+ * Creation option (ug_init() only), ORed with the indicator option:
+ * ug_create() returns before loading the UI gadget, and loading and
+ * creation are done later on the main loop
+ */
+#define UG_OPT_CREATE_DEFERRED (0x04)
+
 /**
  * UI gadget option
  * - Indicator option: [1, 0] bits
+ * - Creation option: [2] bit
  *
  * @see ug_init()
  */
@@ -185,13 +214,13 @@ struct ug_cbs {
  * @param[in] disp Default display
  * @param[in] xid Default xwindow id of default window
  * @param[in] win Default window object, it is void pointer for supporting both GTK (GtkWidget *) and EFL (Evas_Object *)
- * @param[in] opt Default indicator state to restore application's indicator state
+ * @param[in] opt Default indicator state to restore application's indicator state, optionally ORed with UG_OPT_CREATE_DEFERRED
  * @return 0 on success, -1 on error
  *
  * \pre None
  * \post None
  * \see UG_INIT_EFL(), UG_INIT_GTK()
- * \remarks None
+ * \remarks With UG_OPT_CREATE_DEFERRED, ug_create() returns a UI gadget which is not created yet, and its layout callback is invoked later. ug_destroy() on such a UI gadget cancels the remaining loading and creation.
  *
  * \par Sample code:
  * \code
@@ -235,6 +264,7 @@ int ug_init(Display *disp, Window xid, void *win, enum ug_option opt);
  * \post None
  * \see struct ug_cbs, enum ug_mode
  * \remarks If you passed "service", you MUST release it using service_destroy() after ug_create()
+ * \remarks If UG_OPT_CREATE_DEFERRED was given to ug_init(), the returned UI gadget is created later on the main loop, so the layout callback is invoked after ug_create() returns. Destroying it before then cancels the creation. NULL is still returned when the UI gadget is not installed. If the later creation fails, the destroy callback is invoked and the UI gadget is released when the callback returns.
  *
  * \par Sample code:
  * \code
@@ -266,6 +296,327 @@ ui_gadget_h ug_create(ui_gadget_h parent, const char *name,
 					enum ug_mode mode, service_h service,
 					struct ug_cbs *cbs);
 
+/**
+ * \par Description:
+ * This function creates a UI gadget without blocking the main loop
+ *
+ * \par Purpose:
+ * This function is same as ug_create() except that the UI gadget module is looked up and dynamically loaded(dlopen) in a worker thread.
+ *
+ * \par Typical use case:
+ * Anyone who want to create a large UI gadget while an animation is running could use the function.
+ *
+ * \par Method of function operation:
+ * The UI gadget instance is returned immediately with no layout. When the module is loaded, state operations of the UI gadget are invoked in the main loop as ug_create() does, and then the done callback is invoked.
+ *
+ * \par Context of function:
+ * This function supposed to be called after successful initialization with ug_init()
+ *
+ * @param[in] parent parent's UI gadget (see ug_create())
+ * @param[in] name name of UI gadget
+ * @param[in] mode mode of UI gadget (UG_MODE_FULLVIEW | UG_MODE_FRAMEVIEW)
+ * @param[in] service argument for the UI gadget
+ * @param[in] cbs callback functions (see struct ug_cbs) and private data
+ * @param[in] done_cb callback invoked when the creation is finished. The first argument is the UI gadget, or NULL if the creation failed. The second argument is private data of cbs.
+ * @return The pointer of UI gadget, NULL on error
+ *
+ * \pre ug_init()
+ * \post None
+ * \see ug_create()
+ * \remarks The UI gadget could be destroyed with ug_destroy() before the done callback is invoked. In that case, the done callback is not invoked.
+ *
+ * \par Sample code:
+ * \code
+ * #include <ui-gadget.h>
+ * ...
+ * static void _done_cb(ui_gadget_h ug, void *priv)
+ * {
+ * if (!ug)
+ * // creation failed
+ * ...
+ * }
+ * ...
+ * ug = ug_create_async(NULL, "helloUG-efl", UG_MODE_FULLVIEW, service, &cbs, _done_cb);
+ * ...
+ * \endcode
+ */
+ui_gadget_h ug_create_async(ui_gadget_h parent, const char *name,
+					enum ug_mode mode, service_h service,
+					struct ug_cbs *cbs,
+					void (*done_cb) (ui_gadget_h ug, void *priv));
+
+/**
+ * \par Description:
+ * This function preloads a UI gadget module
+ *
+ * \par Purpose:
+ * This function is used for loading a UI gadget module ahead of time, so that a later ug_create_preloaded() does not have to look up and load the module.
+ *
+ * \par Typical use case:
+ * Application developers who know which UI gadget is likely to be created next could use the function, e.g. when a screen which can launch the UI gadget is shown.
+ *
+ * \par Method of function operation:
+ * The UI gadget module with given name is looked up, dynamically loaded(dlopen) and initialized when the main loop becomes idle. If ug_create_preloaded() is called before that, the module is loaded at that time.
+ *
+ * \par Context of function:
+ * This function supposed to be called after successful initialization with ug_init()
+ *
+ * @param[in] name name of UI gadget
+ * @return The preload handle, NULL on error
+ *
+ * \pre ug_init()
+ * \post None
+ * \see ug_create_preloaded(), ug_preload_release()
+ * \remarks The handle MUST be released using ug_preload_release()
+ *
+ * \par Sample code:
+ * \code
+ * #include <ui-gadget.h>
+ * ...
+ * ug_preload_h preload;
+ *
+ * // load "helloUG-efl" module on idle
+ * preload = ug_preload("helloUG-efl");
+ * ...
+ * ug = ug_create_preloaded(NULL, preload, UG_MODE_FULLVIEW, service, &cbs);
+ * ...
+ * ug_preload_release(preload);
+ * ...
+ * \endcode
+ */
+ug_preload_h ug_preload(const char *name);
+
+/**
+ * \par Description:
+ * This function releases a preloaded UI gadget module
+ *
+ * \par Purpose:
+ * This function is used for releasing the preload handle which is returned by ug_preload().
+ *
+ * \par Typical use case:
+ * Application developers who do not need the preloaded UI gadget anymore could use the function.
+ *
+ * \par Method of function operation:
+ * Pending preloading is canceled and the module, unless a UI gadget instance took it over, goes to the module cache. UI gadget instances created with the handle are not affected.
+ *
+ * \par Context of function:
+ * This function supposed to be called after ug_preload()
+ *
+ * @param[in] preload The preload handle
+ * @return 0 on success, -1 on error
+ *
+ * \pre ug_preload()
+ * \post None
+ * \see ug_preload()
+ * \remarks None
+ *
+ * \par Sample code:
+ * \code
+ * #include <ui-gadget.h>
+ * ...
+ * ug_preload_release(preload);
+ * ...
+ * \endcode
+ */
+int ug_preload_release(ug_preload_h preload);
+
+/**
+ * \par Description:
+ * This function preloads several UI gadget modules at once
+ *
+ * \par Purpose:
+ * This function is used for loading the modules of UI gadgets which are shown together, without blocking the main loop.
+ *
+ * \par Typical use case:
+ * Application developers who embed several frameview UI gadgets in one screen could use the function before creating them with ug_create_preloaded().
+ *
+ * \par Method of function operation:
+ * The function returns right away. Modules are looked up and dynamically loaded(dlopen) on a small worker pool, so that file lookups and reads of different modules overlap; the dynamic linker still maps one module at a time. Each module is initialized in the main loop when it is loaded, and the done callback is invoked in the main loop when all of them are handled. A preload handle is returned for every name, even if its module could not be loaded; ug_create_preloaded() loads it again in that case, or when it is called before the module is loaded.
+ *
+ * \par Context of function:
+ * This function supposed to be called in the main loop after successful initialization with ug_init()
+ *
+ * @param[in] names Array of UI gadget names
+ * @param[out] preloads Array of preload handles, which has n elements
+ * @param[in] n Number of names
+ * @param[in] done_cb Callback invoked when all modules are handled, could be NULL
+ * @param[in] priv Private data for done_cb
+ * @return 0 on success, -1 on error
+ *
+ * \pre ug_init()
+ * \post None
+ * \see ug_preload(), ug_create_preloaded(), ug_preload_release()
+ * \remarks Every returned handle MUST be released using ug_preload_release(). A handle could be released before done_cb is invoked; its module goes to the module cache when it is loaded. If the function fails, done_cb is not invoked.
+ *
+ * \par Sample code:
+ * \code
+ * #include <ui-gadget.h>
+ * ...
+ * const char *names[] = { "clockUG", "weatherUG", "calendarUG" };
+ * ug_preload_h preloads[3];
+ *
+ * static void _preloaded_cb(void *priv)
+ * {
+ *	for (i = 0; i < 3; i++)
+ *		ugs[i] = ug_create_preloaded(parent, preloads[i], UG_MODE_FRAMEVIEW, NULL, &cbs);
+ * }
+ * ...
+ * ug_preload_list(names, preloads, 3, _preloaded_cb, NULL);
+ * ...
+ * \endcode
+ */
+int ug_preload_list(const char **names, ug_preload_h *preloads, int n,
+		    void (*done_cb) (void *priv), void *priv);
+
+/**
+ * \par Description:
+ * This function creates a UI gadget from a preloaded module
+ *
+ * \par Purpose:
+ * This function is same as ug_create() except that the module is taken from the given preload handle. The module look up and dynamic loading are skipped.
+ *
+ * \par Typical use case:
+ * Anyone who preloaded a UI gadget with ug_preload() could use the function.
+ *
+ * \par Method of function operation:
+ * The preloaded module is handed over to the new UI gadget instance. If it was already handed over to another instance, a new module is loaded as ug_create() does.
+ *
+ * \par Context of function:
+ * This function supposed to be called after successful initialization with ug_init() and ug_preload()
+ *
+ * @param[in] parent parent's UI gadget (see ug_create())
+ * @param[in] preload The preload handle
+ * @param[in] mode mode of UI gadget (UG_MODE_FULLVIEW | UG_MODE_FRAMEVIEW)
+ * @param[in] service argument for the UI gadget
+ * @param[in] cbs callback functions (see struct ug_cbs) and private data
+ * @return The pointer of UI gadget, NULL on error
+ *
+ * \pre ug_init(), ug_preload()
+ * \post None
+ * \see ug_create(), ug_preload()
+ * \remarks The preload handle can be used for several instances, and it is still valid after the call.
+ *
+ * \par Sample code:
+ * \code
+ * #include <ui-gadget.h>
+ * ...
+ * ug = ug_create_preloaded(NULL, preload, UG_MODE_FULLVIEW, service, &cbs);
+ * ...
+ * \endcode
+ */
+ui_gadget_h ug_create_preloaded(ui_gadget_h parent, ug_preload_h preload,
+					enum ug_mode mode, service_h service,
+					struct ug_cbs *cbs);
+
+/**
+ * \par Description:
+ * This function creates a UI gadget instance which is not shown yet
+ *
+ * \par Purpose:
+ * This function is used for building the layout of a UI gadget ahead of time, so that a later ug_show_prepared() shows it without waiting for the layout creation.
+ *
+ * \par Typical use case:
+ * Application developers who know which UI gadget is likely to be shown next and can afford to keep its layout in memory could use the function.
+ *
+ * \par Method of function operation:
+ * The UI gadget module is loaded and the create operation of the UI gadget is invoked, but the layout stays hidden and the layout callback and the start operation are not invoked. The UI gadget is in "Prepared" state until ug_show_prepared() or ug_destroy() is called. Prepared UI gadgets which are not shown yet are destroyed on UG_EVENT_LOW_MEMORY.
+ *
+ * \par Context of function:
+ * This function supposed to be called after successful initialization with ug_init()
+ *
+ * @param[in] parent parent's UI gadget. If the UI gadget uses the function, the parent has to be the UI gadget. Otherwise, if an application uses the function, the parent has to be NULL
+ * @param[in] name name of UI gadget
+ * @param[in] mode mode of UI gadget (UG_MODE_FULLVIEW | UG_MODE_FRAMEVIEW)
+ * @param[in] service argument for the UI gadget  (see \ref service_PG "Tizen managed api reference guide")
+ * @return The pointer of UI gadget, NULL on error
+ *
+ * \pre ug_init()
+ * \post None
+ * \see ug_show_prepared(), ug_create()
+ * \remarks The handle could be invalidated by UG_EVENT_LOW_MEMORY before it is shown. If you passed "service", you MUST release it using service_destroy() after ug_prepare()
+ *
+ * \par Sample code:
+ * \code
+ * #include <ui-gadget.h>
+ * ...
+ * ug = ug_prepare(NULL, "helloUG-efl", UG_MODE_FULLVIEW, service);
+ * ...
+ * \endcode
+ */
+ui_gadget_h ug_prepare(ui_gadget_h parent, const char *name,
+					enum ug_mode mode, service_h service);
+
+/**
+ * \par Description:
+ * This function shows a UI gadget instance created with ug_prepare()
+ *
+ * \par Purpose:
+ * This function is used for showing a prepared UI gadget and running it.
+ *
+ * \par Typical use case:
+ * Application developers who prepared a UI gadget with ug_prepare() could use the function when the UI gadget has to be shown.
+ *
+ * \par Method of function operation:
+ * The given callbacks are registered, the layout callback is invoked for layout arrangement, and the UI gadget is started. The show effect runs when the layout is shown in the layout callback.
+ *
+ * \par Context of function:
+ * This function supposed to be called after ug_prepare()
+ *
+ * @param[in] ug The prepared UI gadget
+ * @param[in] cbs callback functions (layout callback, result callback, destroy callback, see struct ug_cbs) and private data.
+ * @return 0 on success, -1 on error
+ *
+ * \pre ug_prepare()
+ * \post None
+ * \see ug_prepare()
+ * \remarks It fails if the UI gadget has already been shown or destroyed.
+ *
+ * \par Sample code:
+ * \code
+ * #include <ui-gadget.h>
+ * ...
+ * if (ug_show_prepared(ug, &cbs))
+ * ug = ug_create(NULL, "helloUG-efl", UG_MODE_FULLVIEW, service, &cbs);
+ * ...
+ * \endcode
+ */
+int ug_show_prepared(ui_gadget_h ug, struct ug_cbs *cbs);
+
+/**
+ * \par Description:
+ * This function enables or disables predictive preloading of child UI gadgets
+ *
+ * \par Purpose:
+ * This function is used for making creation of the child UI gadget which usually follows a UI gadget faster, without knowing it in the application.
+ *
+ * \par Typical use case:
+ * Application developers whose users walk through the same sequence of UI gadgets again and again could use the function.
+ *
+ * \par Method of function operation:
+ * Which UI gadget is created as a child of which UI gadget is recorded and kept per application. When enabled, every time a UI gadget starts running, the module of its most frequent child is loaded in the background and kept in the module cache, so that the next ug_create() for it does not have to look up and load the module. Nothing is loaded until a transition has been seen a few times, or while the system is under memory pressure.
+ *
+ * \par Context of function:
+ * This function could be called at any time. Prediction is disabled by default.
+ *
+ * @param[in] enable 1 to enable, 0 to disable
+ * @return 0 on success, -1 on error
+ *
+ * \pre None
+ * \post None
+ * \see ug_create(), ug_preload()
+ * \remarks Predicted modules are initialized in the main loop, so their UG_MODULE_INIT could be called without any following creation.
+ *
+ * \par Sample code:
+ * \code
+ * #include <ui-gadget.h>
+ * ...
+ * ug_init(dpy, xid, win, UG_OPT_INDICATOR_ENABLE);
+ * ug_set_prediction(1);
+ * ...
+ * \endcode
+ */
+int ug_set_prediction(int enable);
+
 /**
  * \par Description:
  * This function pauses all UI gadgets
@@ -510,6 +861,40 @@ void *ug_get_parent_layout(ui_gadget_h ug);
  */
 void *ug_get_window(void);
 
+/**
+ * \par Description:
+ * This function gets the number of fullview UI gadgets
+ *
+ * \par Purpose:
+ * This function is used for getting the depth of the fullview UI gadget stack cheaply.
+ *
+ * \par Typical use case:
+ * Application developers who want to know whether any fullview UI gadget covers the application's own view, e.g. to decide what the back key does, could use the function.
+ *
+ * \par Method of function operation:
+ * This function returns the number of fullview UI gadgets which are created and not destroyed yet. It does not walk the UI gadget tree.
+ *
+ * \par Context of function:
+ * This function supposed to be called after successful initialization with ug_init()
+ *
+ * @return The number of fullview UI gadgets, 0 if there is none
+ *
+ * \pre ug_init()
+ * \post None
+ * \see ug_create()
+ * \remarks None
+ *
+ * \par Sample code:
+ * \code
+ * #include <ui-gadget.h>
+ * ...
+ * if (ug_get_fullview_depth() == 0)
+ * elm_exit();
+ * ...
+ * \endcode
+ */
+int ug_get_fullview_depth(void);
+
 /**
  * \par Description:
  * This function gets mode of the given UI gadget instance
@@ -702,6 +1087,41 @@ int ug_send_message(ui_gadget_h ug, service_h msg);
  */
 int ug_disable_effect(ui_gadget_h ug);
 
+/**
+ * \par Description:
+ * This function returns time spent in a creation phase of the UI gadget
+ *
+ * \par Purpose:
+ * This function is used for finding out which step makes the creation of a UI gadget slow.
+ *
+ * \par Typical use case:
+ * Application developers who want to measure the launching performance of a UI gadget could use the function.
+ *
+ * \par Method of function operation:
+ * Monotonic time is measured around module path lookup, dynamic loading, lookup of UG_MODULE_INIT, UG_MODULE_INIT, create operation, effect layout creation and layout callback. Phases which were not needed, e.g. loading of a module from the module cache, are 0. All of them are also logged in one line when the UI gadget is created.
+ *
+ * \par Context of function:
+ * This function supposed to be called after the UI gadget is created
+ *
+ * @param[in] ug The UI gadget
+ * @param[in] phase The creation phase (see enum ug_timing)
+ * @return Time in microseconds, -1 on error
+ *
+ * \pre ug_create()
+ * \post None
+ * \see enum ug_timing
+ * \remarks None
+ *
+ * \par Sample code:
+ * \code
+ * #include <ui-gadget.h>
+ * ...
+ * printf("dlopen took %d us\n", ug_get_timing(ug, UG_TIMING_DLOPEN));
+ * ...
+ * \endcode
+ */
+int ug_get_timing(ui_gadget_h ug, enum ug_timing phase);
+
 #ifdef __cplusplus
 }
 #endif
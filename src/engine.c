@@ -38,6 +38,12 @@ enum ug_engine_type {
 	UG_ENGINE_EFL = 0x00,
 };
 
+#ifdef UG_ENGINE_BUILTIN
+/* ug-efl-engine.c linked into the library */
+int UG_ENGINE_INIT(struct ug_engine_ops *ops);
+void UG_ENGINE_EXIT(struct ug_engine_ops *ops);
+#endif
+
 static int file_exist(const char *filename)
 {
 	FILE *file;
@@ -66,6 +72,15 @@ struct ug_engine *ug_engine_load()
 		return NULL;
 	}
 
+#ifdef UG_ENGINE_BUILTIN
+	if (type == UG_ENGINE_EFL) {
+		if (!UG_ENGINE_INIT(&engine->ops))
+			return engine;
+		_ERR("builtin engine init failed, try to load engine file\n");
+		memset(&engine->ops, 0, sizeof(engine->ops));
+	}
+#endif
+
 	if (type == UG_ENGINE_EFL) { /* UG_ENGINE_EFL is default*/
 		if (snprintf(engine_file, PATH_MAX, "/usr/lib/libui-gadget-1-efl-engine.so") < 0){
 			goto engine_free;
@@ -121,6 +136,11 @@ int ug_engine_unload(struct ug_engine *engine)
 
 		dlclose(engine->handle);
 	}
+#ifdef UG_ENGINE_BUILTIN
+	else {
+		UG_ENGINE_EXIT(&engine->ops);
+	}
+#endif
 
 	free(engine);
 	return 0;
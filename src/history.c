@@ -0,0 +1,425 @@
+/*
+ *  UI Gadget
+ *
+ * Copyright (c) 2000 - 2011 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * Contact: Jayoun Lee <airjany@samsung.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#define _GNU_SOURCE
+#include <linux/limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <glib.h>
+
+#include "ug-history.h"
+#include "ug-dbg.h"
+
+/*
+ * Per application launch history, one line per UI gadget:
+ *
+ *   L <name> <count> <average delay from ug_init in ms>
+ *
+ * and one line per parent -> child transition:
+ *
+ *   T <parent name> <child name> <count>
+ */
+#define UG_HISTORY_MAX 32
+#define UG_HISTORY_COUNT_MAX 1000
+#define UG_HISTORY_SAVE_DELAY 10
+/* minimum transitions before a child is predicted */
+#define UG_HISTORY_PREDICT_MIN 2
+
+struct ug_history_entry {
+	char *name;
+	int count;
+	int delay;
+};
+
+struct ug_history_transition {
+	char *parent;
+	char *child;
+	int count;
+};
+
+struct ug_history {
+	/* name -> struct ug_history_entry */
+	GHashTable *launches;
+	/* struct ug_history_transition, most frequent first */
+	GList *transitions;
+	unsigned int save_id;
+	int loaded:1;
+	int dirty:1;
+};
+
+static struct ug_history ug_hist;
+
+static void entry_free(void *data)
+{
+	struct ug_history_entry *entry = data;
+
+	free(entry->name);
+	free(entry);
+}
+
+static void transition_free(void *data)
+{
+	struct ug_history_transition *t = data;
+
+	free(t->parent);
+	free(t->child);
+	free(t);
+}
+
+static struct ug_history_transition *transition_get(const char *parent,
+						    const char *child)
+{
+	struct ug_history_transition *t;
+	GList *l;
+
+	for (l = ug_hist.transitions; l; l = l->next) {
+		t = l->data;
+		if (!strcmp(t->parent, parent) && !strcmp(t->child, child))
+			return t;
+	}
+
+	t = calloc(1, sizeof(struct ug_history_transition));
+	if (!t)
+		return NULL;
+
+	t->parent = strdup(parent);
+	t->child = strdup(child);
+	if (!t->parent || !t->child) {
+		transition_free(t);
+		return NULL;
+	}
+
+	ug_hist.transitions = g_list_append(ug_hist.transitions, t);
+	return t;
+}
+
+/* keeps the list ordered by count after t->count was increased */
+static void transition_promote(struct ug_history_transition *t)
+{
+	GList *l;
+	GList *prev;
+
+	l = g_list_find(ug_hist.transitions, t);
+	while (l && (prev = l->prev)
+	       && ((struct ug_history_transition *)prev->data)->count
+	       < t->count) {
+		l->data = prev->data;
+		prev->data = t;
+		l = prev;
+	}
+}
+
+static int get_history_path(char *path, int len)
+{
+	const char *dir;
+	const char *app;
+
+	/* no shared fallback, the history is simply not kept */
+	dir = getenv("HOME");
+	if (!dir || !*dir)
+		return -1;
+
+	app = getenv("PKG_NAME");
+	if (!app)
+		app = program_invocation_short_name;
+
+	snprintf(path, len, "%s/.ug-history.%s", dir, app);
+
+	return 0;
+}
+
+static struct ug_history_entry *entry_get(const char *name)
+{
+	struct ug_history_entry *entry;
+
+	if (!ug_hist.launches)
+		ug_hist.launches = g_hash_table_new_full(g_str_hash,
+							 g_str_equal, NULL,
+							 entry_free);
+
+	entry = g_hash_table_lookup(ug_hist.launches, name);
+	if (entry)
+		return entry;
+
+	entry = calloc(1, sizeof(struct ug_history_entry));
+	if (!entry)
+		return NULL;
+
+	entry->name = strdup(name);
+	if (!entry->name) {
+		free(entry);
+		return NULL;
+	}
+
+	g_hash_table_insert(ug_hist.launches, entry->name, entry);
+	return entry;
+}
+
+void ug_history_load(void)
+{
+	struct ug_history_entry *entry;
+	struct ug_history_transition *t;
+	char path[PATH_MAX];
+	char name[NAME_MAX + 1];
+	char child[NAME_MAX + 1];
+	char line[PATH_MAX];
+	struct stat st;
+	int count, delay;
+	FILE *file;
+	int fd;
+
+	if (ug_hist.loaded)
+		return;
+	ug_hist.loaded = 1;
+
+	if (get_history_path(path, sizeof(path)))
+		return;
+
+	fd = open(path, O_RDONLY | O_NOFOLLOW);
+	if (fd < 0)
+		return;
+
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_uid != geteuid()) {
+		close(fd);
+		return;
+	}
+
+	file = fdopen(fd, "r");
+	if (!file) {
+		close(fd);
+		return;
+	}
+
+	while (fgets(line, sizeof(line), file)) {
+		if (sscanf(line, "T %255s %255s %d", name, child, &count) == 3) {
+			/* saved in order of count */
+			t = transition_get(name, child);
+			if (!t)
+				break;
+			t->count = count;
+			continue;
+		}
+		if (sscanf(line, "L %255s %d %d", name, &count, &delay) != 3)
+			continue;
+		entry = entry_get(name);
+		if (!entry)
+			break;
+		entry->count = count;
+		entry->delay = delay;
+	}
+
+	fclose(file);
+}
+
+static int entry_cmp(const void *a, const void *b)
+{
+	const struct ug_history_entry *ea = *(struct ug_history_entry **)a;
+	const struct ug_history_entry *eb = *(struct ug_history_entry **)b;
+
+	/* more launches first, then the ones launched sooner */
+	if (ea->count != eb->count)
+		return eb->count - ea->count;
+
+	return ea->delay - eb->delay;
+}
+
+/* returns entries sorted by rank, which has to be freed */
+static struct ug_history_entry **entries_sorted(int *n)
+{
+	struct ug_history_entry **entries;
+	GHashTableIter iter;
+	gpointer value;
+	int i = 0;
+
+	*n = ug_hist.launches ? g_hash_table_size(ug_hist.launches) : 0;
+	if (!*n)
+		return NULL;
+
+	entries = calloc(*n, sizeof(struct ug_history_entry *));
+	if (!entries) {
+		*n = 0;
+		return NULL;
+	}
+
+	g_hash_table_iter_init(&iter, ug_hist.launches);
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+		entries[i++] = value;
+
+	qsort(entries, *n, sizeof(struct ug_history_entry *), entry_cmp);
+
+	return entries;
+}
+
+void ug_history_save(void)
+{
+	struct ug_history_entry **entries;
+	struct ug_history_transition *t;
+	char path[PATH_MAX];
+	char tmp[PATH_MAX];
+	FILE *file;
+	GList *l;
+	int i, n, fd;
+
+	if (ug_hist.save_id) {
+		g_source_remove(ug_hist.save_id);
+		ug_hist.save_id = 0;
+	}
+
+	if (!ug_hist.dirty)
+		return;
+	ug_hist.dirty = 0;
+
+	if (get_history_path(path, sizeof(path)))
+		return;
+
+	snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path);
+
+	fd = mkstemp(tmp);
+	if (fd < 0) {
+		_ERR("history: mkstemp failed: %s\n", strerror(errno));
+		return;
+	}
+
+	file = fdopen(fd, "w");
+	if (!file) {
+		close(fd);
+		unlink(tmp);
+		return;
+	}
+
+	entries = entries_sorted(&n);
+	for (i = 0; i < n && i < UG_HISTORY_MAX; i++)
+		fprintf(file, "L %s %d %d\n", entries[i]->name,
+			entries[i]->count, entries[i]->delay);
+	free(entries);
+
+	for (l = ug_hist.transitions, i = 0; l && i < UG_HISTORY_MAX;
+	     l = l->next, i++) {
+		t = l->data;
+		fprintf(file, "T %s %s %d\n", t->parent, t->child, t->count);
+	}
+
+	if (fclose(file) || rename(tmp, path)) {
+		_ERR("history: write failed: %s\n", strerror(errno));
+		unlink(tmp);
+	}
+}
+
+static int history_save_cb(void *data)
+{
+	ug_hist.save_id = 0;
+	ug_history_save();
+
+	return 0;
+}
+
+void ug_history_launch(const char *name, int delay)
+{
+	struct ug_history_entry *entry;
+
+	if (!name)
+		return;
+
+	ug_history_load();
+
+	entry = entry_get(name);
+	if (!entry)
+		return;
+
+	if (delay < 0)
+		delay = 0;
+
+	/* keep the average adaptive by capping the weight of old launches */
+	if (entry->count < UG_HISTORY_COUNT_MAX)
+		entry->count++;
+	entry->delay += (delay - entry->delay) / entry->count;
+
+	ug_hist.dirty = 1;
+	if (!ug_hist.save_id)
+		ug_hist.save_id = g_timeout_add_seconds(UG_HISTORY_SAVE_DELAY,
+							history_save_cb, NULL);
+}
+
+int ug_history_top(const char **names, int max)
+{
+	struct ug_history_entry **entries;
+	int i, n;
+
+	ug_history_load();
+
+	entries = entries_sorted(&n);
+	for (i = 0; i < n && i < max; i++)
+		names[i] = entries[i]->name;
+	free(entries);
+
+	return i;
+}
+
+void ug_history_transition(const char *parent, const char *child)
+{
+	struct ug_history_transition *t;
+
+	if (!parent || !child)
+		return;
+
+	ug_history_load();
+
+	t = transition_get(parent, child);
+	if (!t)
+		return;
+
+	if (t->count < UG_HISTORY_COUNT_MAX)
+		t->count++;
+	transition_promote(t);
+
+	ug_hist.dirty = 1;
+	if (!ug_hist.save_id)
+		ug_hist.save_id = g_timeout_add_seconds(UG_HISTORY_SAVE_DELAY,
+							history_save_cb, NULL);
+}
+
+const char *ug_history_predict(const char *parent)
+{
+	struct ug_history_transition *t;
+	GList *l;
+
+	if (!parent)
+		return NULL;
+
+	ug_history_load();
+
+	/* the first match is the most frequent one */
+	for (l = ug_hist.transitions; l; l = l->next) {
+		t = l->data;
+		if (t->count < UG_HISTORY_PREDICT_MIN)
+			break;
+		if (!strcmp(t->parent, parent))
+			return t->child;
+	}
+
+	return NULL;
+}
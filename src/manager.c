@@ -19,22 +19,40 @@
  *
  */
 
+#include <linux/limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <glib.h>
 #include <utilX.h>
 
 #include "ug.h"
 #include "ug-manager.h"
+#include "ug-walk.h"
 #include "ug-engine.h"
+#include "ug-module-manifest.h"
+#include "ug-history.h"
 #include "ug-dbg.h"
 
+/* period after UG_EVENT_LOW_MEMORY which is regarded as memory pressure */
+#define UG_LOW_MEMORY_PERIOD (30 * 1000 * 1000)
+/* modules declaring more memory than this (KB) need room to be loaded */
+#define UG_LARGE_MODULE_MEMORY 4096
+/* number of frequently launched modules read ahead at ug_init() */
+#define UG_READAHEAD_MAX 3
+/* number of threads loading modules of ug_preload_list() */
+#define UG_PRELOAD_THREADS 4
+
 struct ug_manager {
 	ui_gadget_h root;
+	/* fullview stack linked through fv_next from the top */
 	ui_gadget_h fv_top;
-	GSList *fv_list;
+	/* fullview ugs in the stack, the root is not counted */
+	int fv_depth;
 
 	void *win;
 	Window win_id;
@@ -50,23 +68,146 @@ struct ug_manager {
 	int destroy_all:1;
 
 	struct ug_engine *engine;
+
+	/* nodes linked under the root, the root itself is not included */
+	GHashTable *live;
+
+	/* ugs handling each event, the latest created first */
+	GSList *subscribers[UG_EVENT_MAX];
+
+	GThreadPool *loader;
+	GThreadPool *prefetcher;
+	GThreadPool *preloader;
+	gint64 low_memory_time;
+	gint64 init_time;
+	unsigned int readahead_id;
+
+	int predict:1;
+	/* pending loading of the predicted next child */
+	struct ug_load_job *predict_job;
+	GThreadPool *predictor;
+};
+
+struct ug_load_job {
+	/* NULL if the pending ug has been destroyed */
+	ui_gadget_h ug;
+	const char *name;
+	struct ug_module *module;
+	void (*done_cb) (ui_gadget_h ug, void *priv);
+	void *priv;
+	/* public function the job is made for, to log failures */
+	const char *api;
+	/* argument of the module's prepare operation */
+	service_h service;
+	/* speculative loading of a predicted child, ug is always NULL */
+	int predict:1;
+	/* run the prepare operation instead of loading the module */
+	int prepare:1;
+	int failed:1;
+};
+
+struct ug_preload_list {
+	/* jobs which are not done yet */
+	int pending;
+	void (*done_cb) (void *priv);
+	void *priv;
+};
+
+struct ug_preload_job {
+	/* NULL if the handle was released while loading */
+	struct ug_preload_s *preload;
+	const char *name;
+	struct ug_module *module;
+	struct ug_preload_list *list;
+};
+
+struct ug_prefetch_job {
+	/* NULL terminated resource files from the manifest */
+	char **files;
+};
+
+struct ug_populate_job {
+	/* NULL if the ug has been destroyed */
+	ui_gadget_h ug;
 };
 
 static struct ug_manager ug_man;
 
 static inline void job_start(void);
 static inline void job_end(void);
+static void ugman_predict(ui_gadget_h ug);
+static ui_gadget_h ugman_ug_load_job(ui_gadget_h parent,
+				const char *name,
+				enum ug_mode mode,
+				service_h service, struct ug_cbs *cbs,
+				void (*done_cb) (ui_gadget_h ug, void *priv),
+				int deferred);
 
 static int ug_relation_add(ui_gadget_h p, ui_gadget_h c)
 {
+	if (!ug_man.live) {
+		ug_man.live = g_hash_table_new(g_direct_hash, g_direct_equal);
+		if (!ug_man.live)
+			return -1;
+	}
+
+	/* the latest child comes first */
 	c->parent = p;
-	/* prepend element to avoid the inefficiency,
-		which is to traverse the entire list to find the end*/
-	p->children = g_slist_prepend(p->children, c);
+	c->prev_sibling = NULL;
+	c->next_sibling = p->first_child;
+	if (p->first_child)
+		p->first_child->prev_sibling = c;
+	p->first_child = c;
+
+	g_hash_table_insert(ug_man.live, c, c);
 
 	return 0;
 }
 
+static void ug_relation_forget_post(ui_gadget_h ug, int depth, void *data)
+{
+	g_hash_table_remove(ug_man.live, ug);
+}
+
+/* the subtree is not reachable from the root anymore */
+static void ug_relation_forget(ui_gadget_h ug)
+{
+	ug_walk(ug, NULL, ug_relation_forget_post, NULL);
+}
+
+static int ugman_ug_handles(ui_gadget_h ug, enum ug_event event)
+{
+	struct ug_module_ops *ops;
+
+	if (!ug->module || !ug->module->ops.event)
+		return 0;
+
+	ops = &ug->module->ops;
+	return !ops->event_mask || (ops->event_mask & UG_EVENT_MASK(event));
+}
+
+static void ugman_ug_subscribe(ui_gadget_h ug)
+{
+	int event;
+
+	for (event = UG_EVENT_NONE + 1; event < UG_EVENT_MAX; event++)
+		if (ugman_ug_handles(ug, event))
+			ug_man.subscribers[event] =
+			    g_slist_prepend(ug_man.subscribers[event], ug);
+}
+
+static void ugman_ug_unsubscribe(ui_gadget_h ug)
+{
+	int event;
+
+	if (!ug->module || !ug->module->ops.event)
+		return;
+
+	for (event = UG_EVENT_NONE + 1; event < UG_EVENT_MAX; event++)
+		ug_man.subscribers[event] =
+		    g_slist_remove(ug_man.subscribers[event], ug);
+}
+
 static int ug_relation_del(ui_gadget_h ug)
 {
 	ui_gadget_h p;
@@ -76,91 +217,165 @@ static int ug_relation_del(ui_gadget_h ug)
 		_ERR("ug_relation_del failed: no parent\n");
 		return -1;
 	}
-	p->children = g_slist_remove(p->children, ug);
-	if (ug->children)
-		g_slist_free(ug->children);
+	ug_relation_forget(ug);
+
+	if (ug->prev_sibling)
+		ug->prev_sibling->next_sibling = ug->next_sibling;
+	else
+		p->first_child = ug->next_sibling;
+	if (ug->next_sibling)
+		ug->next_sibling->prev_sibling = ug->prev_sibling;
+	ug->prev_sibling = NULL;
+	ug->next_sibling = NULL;
+	ug->first_child = NULL;
 	ug->parent = NULL;
 
+	ugman_ug_unsubscribe(ug);
+
 	return 0;
 }
 
 static int ug_fvlist_add(ui_gadget_h c)
 {
-	ug_man.fv_list = g_slist_prepend(ug_man.fv_list, c);
+	c->fv_prev = NULL;
+	c->fv_next = ug_man.fv_top;
+	if (ug_man.fv_top)
+		ug_man.fv_top->fv_prev = c;
 	ug_man.fv_top = c;
 
+	if (c != ug_man.root)
+		ug_man.fv_depth++;
+
 	return 0;
 }
 
 static int ug_fvlist_del(ui_gadget_h c)
 {
-	ui_gadget_h t;
+	/* not in the stack */
+	if (!c->fv_prev && !c->fv_next && ug_man.fv_top != c)
+		return 0;
 
-	ug_man.fv_list = g_slist_remove(ug_man.fv_list, c);
+	if (c->fv_prev)
+		c->fv_prev->fv_next = c->fv_next;
+	else
+		ug_man.fv_top = c->fv_next;	/* update fullview top ug */
+	if (c->fv_next)
+		c->fv_next->fv_prev = c->fv_prev;
+	c->fv_prev = NULL;
+	c->fv_next = NULL;
 
-	/* update fullview top ug*/
-	t = g_slist_nth_data(ug_man.fv_list, 0);
-	ug_man.fv_top = t;
+	if (c != ug_man.root)
+		ug_man.fv_depth--;
 
 	return 0;
 }
 
-static void ugman_tree_dump(ui_gadget_h ug)
+static enum ug_walk_ret ugman_tree_dump_pre(ui_gadget_h ug, int depth,
+					    void *data)
 {
-	static int i;
-	int lv;
 	const char *name;
-	GSList *child;
-	ui_gadget_h c;
 
+	if (!depth)
+		return UG_WALK_CONTINUE;
+
+	name = ug->parent == ug_man.root ? "Manager" : ug->parent->name;
+	_DBG("[%d] %s [%c] (%p) (PARENT:  %s)\n",
+	     depth,
+	     ug->name ? ug->name : "NO CHILD INFO FIXIT!!!",
+	     ug->mode == UG_MODE_FULLVIEW ? 'F' : 'f', ug, name);
+
+	return UG_WALK_CONTINUE;
+}
+
+static void ugman_tree_dump(ui_gadget_h ug)
+{
 	if (!ug)
 		return;
 
-	name = ug->name;
 	if (ug == ug_man.root) {
-		i = 0;
 		_DBG("\n============== TREE_DUMP =============\n");
 		_DBG("ROOT: Manager\n");
-		name = "Manager";
 	}
 
-	child = ug->children;
-	if (!child)
+	ug_walk(ug, ugman_tree_dump_pre, NULL, NULL);
+}
+
+static void ugman_ug_load_cancel(ui_gadget_h ug)
+{
+	struct ug_load_job *job = ug->load_job;
+
+	if (!job)
 		return;
 
-	i++;
-	lv = i;
+	job->ug = NULL;
+	ug->load_job = NULL;
+}
 
-	while (child) {
-		c = child->data;
-		_DBG("[%d] %s [%c] (%p) (PARENT:  %s)\n",
-		     lv,
-		     c && c->name ? c->name : "NO CHILD INFO FIXIT!!!",
-		     c && c->mode == UG_MODE_FULLVIEW ? 'F' : 'f', c, name);
-		ugman_tree_dump(c);
-		child = g_slist_next(child);
-	}
+static void ugman_ug_populate_cancel(ui_gadget_h ug)
+{
+	struct ug_populate_job *job = ug->populate_job;
+
+	if (!job)
+		return;
+
+	job->ug = NULL;
+	ug->populate_job = NULL;
 }
 
-static int ugman_ug_find(ui_gadget_h p, ui_gadget_h ug)
+static int ugman_ug_populate(void *data)
 {
-	GSList *child = NULL;
+	struct ug_populate_job *job = data;
+	ui_gadget_h ug = job->ug;
+	struct ug_module_ops *ops;
 
-	if (!p || !ug)
+	free(job);
+	if (!ug)
 		return 0;
-	child = p->children;
 
-	while (child) {
-		if (child->data == ug)
-			return 1;
-		if (ugman_ug_find(child->data, ug))
-			return 1;
-		child = g_slist_next(child);
-	}
+	ug->populate_job = NULL;
+
+	ops = &ug->module->ops;
+	ops->populate(ug, ug->service, ops->priv);
 
 	return 0;
 }
 
+static void ugman_ug_rendered(void *data)
+{
+	/* out of the rendering */
+	g_idle_add(ugman_ug_populate, data);
+}
+
+static void ugman_ug_populate_schedule(ui_gadget_h ug)
+{
+	struct ug_populate_job *job;
+	struct ug_engine_ops *eng_ops = NULL;
+
+	if (!ug->module || !ug->module->ops.populate || ug->populate_job)
+		return;
+
+	job = calloc(1, sizeof(struct ug_populate_job));
+	if (!job) {
+		/* no way to defer it */
+		ug->module->ops.populate(ug, ug->service,
+					 ug->module->ops.priv);
+		return;
+	}
+
+	job->ug = ug;
+	ug->populate_job = job;
+
+	if (ug_man.engine)
+		eng_ops = &ug_man.engine->ops;
+
+	if (eng_ops && eng_ops->render_post
+	    && !eng_ops->render_post(ug_man.win, ugman_ug_rendered, job))
+		return;
+
+	/* no engine support, the frame is likely to be done on idle */
+	g_idle_add_full(G_PRIORITY_LOW, ugman_ug_populate, job, NULL);
+}
+
 static int ugman_ug_start(void *data)
 {
 	ui_gadget_h ug = data;
@@ -178,79 +393,85 @@ static int ugman_ug_start(void *data)
 	if (ops && ops->start)
 		ops->start(ug, ug->service, ops->priv);
 
+	if (ug_man.predict)
+		ugman_predict(ug);
+
 	return 0;
 }
 
-static int ugman_ug_pause(void *data)
+static enum ug_walk_ret ugman_ug_pause_pre(ui_gadget_h ug, int depth,
+					   void *data)
 {
-	ui_gadget_h ug = data;
-	struct ug_module_ops *ops = NULL;
-	GSList *child = NULL;
-
-	job_start();
-
-	if (!ug || ug->state != UG_STATE_RUNNING)
-		goto end;
+	if (ug->state != UG_STATE_RUNNING)
+		return UG_WALK_SKIP;
 
 	ug->state = UG_STATE_STOPPED;
 
-	if (ug->children) {
-		child = ug->children;
-		while (child) {
-			ugman_ug_pause(child->data);
-			child = g_slist_next(child);
-		}
-	}
+	return UG_WALK_CONTINUE;
+}
+
+static void ugman_ug_pause_post(ui_gadget_h ug, int depth, void *data)
+{
+	struct ug_module_ops *ops = NULL;
 
 	if (ug->module)
 		ops = &ug->module->ops;
 
 	if (ops && ops->pause)
 		ops->pause(ug, ug->service, ops->priv);
-
- end:
-	job_end();
-	return 0;
 }
 
-static int ugman_ug_resume(void *data)
+static int ugman_ug_pause(void *data)
 {
 	ui_gadget_h ug = data;
-	struct ug_module_ops *ops = NULL;
-	GSList *child = NULL;
 
 	job_start();
 
-	if (!ug)
-		goto end;
+	if (ug)
+		ug_walk(ug, ugman_ug_pause_pre, ugman_ug_pause_post, NULL);
+
+	job_end();
+	return 0;
+}
 
+static enum ug_walk_ret ugman_ug_resume_pre(ui_gadget_h ug, int depth,
+					    void *data)
+{
 	switch (ug->state) {
 	case UG_STATE_CREATED:
 		ugman_ug_start(ug);
-		goto end;
+		return UG_WALK_SKIP;
 	case UG_STATE_STOPPED:
 		break;
 	default:
-		goto end;
+		return UG_WALK_SKIP;
 	}
 
 	ug->state = UG_STATE_RUNNING;
 
-	if (ug->children) {
-		child = ug->children;
-		while (child) {
-			ugman_ug_resume(child->data);
-			child = g_slist_next(child);
-		}
-	}
+	return UG_WALK_CONTINUE;
+}
+
+static void ugman_ug_resume_post(ui_gadget_h ug, int depth, void *data)
+{
+	struct ug_module_ops *ops = NULL;
 
 	if (ug->module)
 		ops = &ug->module->ops;
 
 	if (ops && ops->resume)
 		ops->resume(ug, ug->service, ops->priv);
+}
+
+static int ugman_ug_resume(void *data)
+{
+	ui_gadget_h ug = data;
+
+	job_start();
+
+	if (ug)
+		ug_walk(ug, ugman_ug_resume_pre, ugman_ug_resume_post, NULL);
 
- end:
 	job_end();
 	return 0;
 }
@@ -288,259 +509,1067 @@ static int ugman_indicator_update(enum ug_option opt, enum ug_event event)
 		return -1;
 	}
 
-	utilx_enable_indicator(ug_man.disp, ug_man.win_id, enable);
+	utilx_enable_indicator(ug_man.disp, ug_man.win_id, enable);
+
+	return 0;
+}
+
+static int ugman_ug_getopt(ui_gadget_h ug)
+{
+	if (!ug)
+		return -1;
+	/* Indicator Option */
+	if (ug->mode == UG_MODE_FULLVIEW)
+		ugman_indicator_update(UG_OPT_INDICATOR(ug->opt), UG_EVENT_NONE);
+
+	return 0;
+}
+
+static void ugman_ug_event_post(ui_gadget_h ug, int depth, void *data)
+{
+	enum ug_event event = (enum ug_event)data;
+	struct ug_module_ops *ops;
+
+	if (!ugman_ug_handles(ug, event))
+		return;
+
+	ops = &ug->module->ops;
+	ops->event(ug, event, ug->service, ops->priv);
+}
+
+static int ugman_ug_event(ui_gadget_h ug, enum ug_event event)
+{
+	if (!ug)
+		return 0;
+
+	ug_walk(ug, NULL, ugman_ug_event_post, (void *)event);
+
+	return 0;
+}
+
+static void ugman_event_dispatch(enum ug_event event)
+{
+	struct ug_module_ops *ops;
+	GSList *l, *next;
+	ui_gadget_h ug;
+
+	/* destruction is deferred, so the list does not lose any node */
+	for (l = ug_man.subscribers[event]; l; l = next) {
+		next = g_slist_next(l);
+		ug = l->data;
+		ops = &ug->module->ops;
+		ops->event(ug, event, ug->service, ops->priv);
+	}
+}
+
+static enum ug_walk_ret ugman_ug_destroy_pre(ui_gadget_h ug, int depth,
+					     void *data)
+{
+	switch (ug->state) {
+	case UG_STATE_READY:
+		/* pending creation, the load job is canceled below */
+	case UG_STATE_PREPARED:
+	case UG_STATE_CREATED:
+	case UG_STATE_RUNNING:
+	case UG_STATE_STOPPED:
+	case UG_STATE_DESTROYING:
+		break;
+	default:
+		return UG_WALK_SKIP;
+	}
+
+	ug->state = UG_STATE_DESTROYED;
+
+	ugman_ug_load_cancel(ug);
+	ugman_ug_populate_cancel(ug);
+
+	return UG_WALK_CONTINUE;
+}
+
+static void ugman_ug_destroy_post(ui_gadget_h ug, int depth, void *data)
+{
+	struct ug_module_ops *ops = NULL;
+
+	if (ug->module)
+		ops = &ug->module->ops;
+
+	if (ops && ops->destroy)
+		ops->destroy(ug, ug->service, ops->priv);
+
+	ug_relation_del(ug);
+
+	if (ug->mode == UG_MODE_FULLVIEW) {
+		if (ug_man.fv_top == ug) {
+			ug_fvlist_del(ug);
+			ugman_ug_getopt(ug_man.fv_top);
+		} else {
+			ug_fvlist_del(ug);
+		}
+	}
+
+	ug_free(ug);
+
+	if (ug_man.root == ug) {
+		ug_man.root = NULL;
+		/* the whole tree is gone, release cached modules as well */
+		ug_module_cache_flush();
+		ug_module_teardown_flush();
+		ug_module_manifest_flush();
+		ug_history_save();
+	}
+}
+
+static int ugman_ug_destroy(void *data)
+{
+	ui_gadget_h ug = data;
+
+	job_start();
+
+	if (!ug)
+		goto end;
+
+	ug_walk(ug, ugman_ug_destroy_pre, ugman_ug_destroy_post, NULL);
+
+	ugman_tree_dump(ug_man.root);
+ end:
+	job_end();
+
+	return 0;
+}
+
+static void ug_hide_end_cb(ui_gadget_h ug)
+{
+	g_idle_add(ugman_ug_destroy, ug);
+}
+
+/* builds the layout, which is not shown until ugman_ug_show() */
+static int ugman_ug_build(ui_gadget_h ug)
+{
+	struct ug_module_ops *ops = NULL;
+	struct ug_engine_ops *eng_ops = NULL;
+	gint64 t;
+
+	if (ug->module)
+		ops = &ug->module->ops;
+
+	if (ug_man.engine)
+		eng_ops = &ug_man.engine->ops;
+
+	/* loading phases are measured by the module */
+	if (ug->module)
+		memcpy(ug->timing, ug->module->timing,
+		       sizeof(ug->timing[0]) * UG_TIMING_CREATE);
+
+	if (ops && ops->create) {
+		t = g_get_monotonic_time();
+		ug->layout = ops->create(ug, ug->mode, ug->service, ops->priv);
+		ug->timing[UG_TIMING_CREATE] = g_get_monotonic_time() - t;
+		if (!ug->layout) {
+			ug_relation_del(ug);
+			return -1;
+		}
+		if (ug->mode == UG_MODE_FULLVIEW) {
+			t = g_get_monotonic_time();
+			if (eng_ops && eng_ops->create)
+				ug->effect_layout = eng_ops->create(ug_man.win, ug, ug_hide_end_cb);
+			ug->timing[UG_TIMING_ENGINE_CREATE] =
+			    g_get_monotonic_time() - t;
+		}
+	}
+
+	ugman_ug_subscribe(ug);
+
+	return 0;
+}
+
+static int ugman_ug_show(ui_gadget_h ug)
+{
+	struct ug_module_ops *ops = NULL;
+	struct ug_cbs *cbs;
+	gint64 t;
+
+	if (ug->module)
+		ops = &ug->module->ops;
+
+	if (ops && ops->create) {
+		cbs = &ug->cbs;
+
+		t = g_get_monotonic_time();
+		if (cbs && cbs->layout_cb)
+			cbs->layout_cb(ug, ug->mode, cbs->priv);
+		ug->timing[UG_TIMING_LAYOUT] = g_get_monotonic_time() - t;
+
+		ugman_ug_getopt(ug);
+	}
+
+	ugman_ug_event(ug, ug_man.last_rotate_evt);
+	ugman_ug_start(ug);
+	ugman_ug_populate_schedule(ug);
+	ugman_tree_dump(ug_man.root);
+
+	_INFO("timing: name=%s resolve=%d dlopen=%d dlsym=%d init=%d"
+	      " create=%d engine_create=%d layout=%d (usec)\n", ug->name,
+	      ug->timing[UG_TIMING_RESOLVE], ug->timing[UG_TIMING_DLOPEN],
+	      ug->timing[UG_TIMING_DLSYM], ug->timing[UG_TIMING_INIT],
+	      ug->timing[UG_TIMING_CREATE],
+	      ug->timing[UG_TIMING_ENGINE_CREATE],
+	      ug->timing[UG_TIMING_LAYOUT]);
+
+	ug_history_launch(ug->name, (g_get_monotonic_time() - ug_man.init_time)
+			  / 1000);
+	if (ug->parent && ug->parent != ug_man.root)
+		ug_history_transition(ug->parent->name, ug->name);
+
+	return 0;
+}
+
+static int ugman_ug_create(void *data)
+{
+	ui_gadget_h ug = data;
+
+	if (!ug || ug->state != UG_STATE_READY)
+		return -1;
+
+	ug->state = UG_STATE_CREATED;
+
+	if (ugman_ug_build(ug))
+		return -1;
+
+	return ugman_ug_show(ug);
+}
+
+static void ugman_file_readahead(const char *path)
+{
+	struct stat st;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return;
+
+	if (!fstat(fd, &st))
+		posix_fadvise(fd, 0, st.st_size, POSIX_FADV_WILLNEED);
+	close(fd);
+}
+
+static void ugman_prefetch_thread(void *data, void *user_data)
+{
+	struct ug_prefetch_job *job = data;
+	char **file;
+
+	for (file = job->files; *file; file++)
+		ugman_file_readahead(*file);
+
+	g_strfreev(job->files);
+	free(job);
+}
+
+/* reads resources declared in the manifest, while the module is loaded */
+static void ugman_ug_prefetch(const char *name)
+{
+	struct ug_manifest *manifest;
+	struct ug_prefetch_job *job;
+
+	manifest = ug_module_manifest_get(name);
+	if (!manifest || !manifest->resources || !*manifest->resources)
+		goto end;
+
+	if (!ug_thread_pool_get(&ug_man.prefetcher, ugman_prefetch_thread, 1))
+		goto end;
+
+	job = calloc(1, sizeof(struct ug_prefetch_job));
+	if (!job)
+		goto end;
+
+	/* the job takes over the copied list */
+	job->files = manifest->resources;
+	manifest->resources = NULL;
+	g_thread_pool_push(ug_man.prefetcher, job, NULL);
+ end:
+	ug_module_manifest_free(manifest);
+}
+
+/*
+ * warms up toolkit caches with the resources right before the create
+ * operation. only worth it when the main loop was free while loading.
+ */
+static void ugman_ug_warm_up(const char *name)
+{
+	struct ug_manifest *manifest;
+	struct ug_engine_ops *eng_ops = NULL;
+	char **file;
+
+	if (ug_man.engine)
+		eng_ops = &ug_man.engine->ops;
+
+	if (!eng_ops || !eng_ops->prefetch)
+		return;
+
+	manifest = ug_module_manifest_get(name);
+	if (!manifest)
+		return;
+
+	/* toolkit caches are not thread safe, done on main loop */
+	for (file = manifest->resources; file && *file; file++)
+		eng_ops->prefetch(*file);
+
+	ug_module_manifest_free(manifest);
+}
+
+static int ugman_is_low_memory(void)
+{
+	return ug_man.low_memory_time &&
+	    g_get_monotonic_time() - ug_man.low_memory_time
+	    < UG_LOW_MEMORY_PERIOD;
+}
+
+/* returns 0 if the module could be loaded now */
+static int ugman_ug_admit(const char *name, int preload)
+{
+	struct ug_manifest *manifest;
+	int memory;
+
+	if (!ugman_is_low_memory())
+		return 0;
+
+	manifest = ug_module_manifest_get(name);
+	if (!manifest)
+		return 0;
+
+	memory = manifest->memory;
+	ug_module_manifest_free(manifest);
+
+	if (memory < UG_LARGE_MODULE_MEMORY)
+		return 0;
+
+	/* speculative loading is not worth it under memory pressure */
+	if (preload)
+		return -1;
+
+	_DBG("%s needs %d KB under memory pressure, flush module cache\n",
+	     name, memory);
+	ug_module_cache_flush();
+
+	return 0;
+}
+
+static int ugman_ug_attach(ui_gadget_h parent, ui_gadget_h ug)
+{
+	if (!ug_man.is_initted) {
+		_ERR("ugman_ug_attach failed: manager is not initted\n");
+		return -1;
+	}
+
+	if (!ug_man.root) {
+		if (parent) {
+			_ERR("ugman_ug_attach failed: parent has to be NULL w/o root\n");
+			errno = EINVAL;
+			return -1;
+		}
+
+		ug_man.root = ug_root_create();
+		if (!ug_man.root)
+			return -1;
+		ug_man.root->opt = ug_man.base_opt;
+		ug_man.root->layout = ug_man.win;
+		ug_fvlist_add(ug_man.root);
+	}
+
+	if (!parent)
+		parent = ug_man.root;
+
+	return ug_relation_add(parent, ug);
+}
+
+int ugman_ug_add(ui_gadget_h parent, ui_gadget_h ug)
+{
+	if (ugman_ug_attach(parent, ug))
+		return -1;
+
+	if (ugman_ug_create(ug) == -1)
+		return -1;
+
+	if (ug->mode == UG_MODE_FULLVIEW)
+		ug_fvlist_add(ug);
+
+	return 0;
+}
+
+static ui_gadget_h ugman_ug_load_module(ui_gadget_h parent,
+				const char *name,
+				struct ug_module *module,
+				enum ug_mode mode,
+				service_h service, struct ug_cbs *cbs)
+{
+	int r;
+	ui_gadget_h ug;
+
+	ug = ug_alloc(name);
+	if (!ug) {
+		_ERR("ug_create() failed: Memory allocation failed\n");
+		ug_module_unload(module);
+		return NULL;
+	}
+
+	ug->module = module;
+
+	ug->mode = mode;
+	service_clone(&ug->service, service);
+	ug->opt = ug->module->ops.opt;
+	ug->state = UG_STATE_READY;
+
+	if (cbs)
+		memcpy(&ug->cbs, cbs, sizeof(struct ug_cbs));
+
+	/* ug_create() is synchronous, so is the module's own setup */
+	if (module->ops.prepare
+	    && module->ops.prepare(ug->service, module->ops.priv)) {
+		_ERR("ug_create() failed: %s prepare failed\n", name);
+		goto load_fail;
+	}
+
+	r = ugman_ug_add(parent, ug);
+	if (r) {
+		_ERR("ug_create() failed: Tree update failed\n");
+		goto load_fail;
+	}
+
+	return ug;
+
+ load_fail:
+	ug_free(ug);
+	return NULL;
+}
+
+ui_gadget_h ugman_ug_load(ui_gadget_h parent,
+				const char *name,
+				enum ug_mode mode,
+				service_h service, struct ug_cbs *cbs)
+{
+	struct ug_module *module;
+
+	/* nothing is loaded until the main loop gets back */
+	if (ug_man.base_opt & UG_OPT_CREATE_DEFERRED) {
+		if (!ug_module_exist(name)) {
+			_ERR("ug_create() failed: %s is not installed\n", name);
+			errno = ENOENT;
+			return NULL;
+		}
+		return ugman_ug_load_job(parent, name, mode, service, cbs,
+					 NULL, 1);
+	}
+
+	ugman_ug_admit(name, 0);
+	ugman_ug_prefetch(name);
+
+	module = ug_module_load(name);
+	if (!module) {
+		_ERR("ug_create() failed: Module loading failed\n");
+		return NULL;
+	}
+
+	return ugman_ug_load_module(parent, name, module, mode, service, cbs);
+}
+
+ui_gadget_h ugman_ug_prepare(ui_gadget_h parent,
+				const char *name,
+				enum ug_mode mode,
+				service_h service)
+{
+	struct ug_engine_ops *eng_ops = NULL;
+	struct ug_module *module;
+	ui_gadget_h ug;
+
+	ugman_ug_admit(name, 0);
+	ugman_ug_prefetch(name);
+
+	module = ug_module_load(name);
+	if (!module) {
+		_ERR("ug_prepare() failed: Module loading failed\n");
+		return NULL;
+	}
+
+	ug = ug_alloc(name);
+	if (!ug) {
+		_ERR("ug_prepare() failed: Memory allocation failed\n");
+		ug_module_unload(module);
+		return NULL;
+	}
+
+	ug->module = module;
+	ug->mode = mode;
+	service_clone(&ug->service, service);
+	ug->opt = ug->module->ops.opt;
+	ug->state = UG_STATE_PREPARED;
+
+	if (ugman_ug_attach(parent, ug)) {
+		_ERR("ug_prepare() failed: Tree update failed\n");
+		ug_free(ug);
+		return NULL;
+	}
+
+	/* the layout is built ahead of time anyway, no need for a thread */
+	if (module->ops.prepare
+	    && module->ops.prepare(ug->service, module->ops.priv)) {
+		_ERR("ug_prepare() failed: %s prepare failed\n", name);
+		ug_relation_del(ug);
+		ug_free(ug);
+		return NULL;
+	}
+
+	if (ugman_ug_build(ug)) {
+		_ERR("ug_prepare() failed: Layout creation failed\n");
+		ug_free(ug);
+		return NULL;
+	}
+
+	if (ug_man.engine)
+		eng_ops = &ug_man.engine->ops;
+
+	if (ug->effect_layout && eng_ops && eng_ops->prepare)
+		eng_ops->prepare(ug);
+
+	/* keep rotation of the hidden layout up to date */
+	ugman_ug_event(ug, ug_man.last_rotate_evt);
+
+	return ug;
+}
+
+int ugman_ug_show_prepared(ui_gadget_h ug, struct ug_cbs *cbs)
+{
+	if (!ug || !ugman_ug_exist(ug) || ug->state != UG_STATE_PREPARED
+	    || ug->destroy_me) {
+		_ERR("ug_show_prepared() failed: Invalid ug\n");
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (cbs)
+		memcpy(&ug->cbs, cbs, sizeof(struct ug_cbs));
+
+	ug->state = UG_STATE_CREATED;
+
+	if (ug->mode == UG_MODE_FULLVIEW)
+		ug_fvlist_add(ug);
+
+	return ugman_ug_show(ug);
+}
+
+static int ugman_preload_idle(void *data)
+{
+	struct ug_preload_s *preload = data;
+
+	preload->idle_id = 0;
+	if (ugman_ug_admit(preload->name, 1)) {
+		_DBG("ug_preload() skipped under memory pressure: %s\n",
+		     preload->name);
+		return 0;
+	}
+
+	ugman_ug_prefetch(preload->name);
+	preload->module = ug_module_load(preload->name);
+	if (!preload->module)
+		_ERR("ug_preload() failed: Module loading failed: %s\n",
+		     preload->name);
+
+	return 0;
+}
+
+ug_preload_h ugman_preload(const char *name)
+{
+	struct ug_preload_s *preload;
+
+	preload = calloc(1, sizeof(struct ug_preload_s));
+	if (!preload) {
+		_ERR("ug_preload() failed: Memory allocation failed\n");
+		return NULL;
+	}
+
+	preload->name = strdup(name);
+	if (!preload->name) {
+		free(preload);
+		return NULL;
+	}
+
+	preload->idle_id = g_idle_add(ugman_preload_idle, preload);
+
+	return preload;
+}
+
+static int ugman_preload_list_done(void *data)
+{
+	struct ug_preload_list *list = data;
+
+	if (list->done_cb)
+		list->done_cb(list->priv);
+	free(list);
+
+	return 0;
+}
+
+static int ugman_preload_done(void *data)
+{
+	struct ug_preload_job *job = data;
+	struct ug_preload_list *list = job->list;
+
+	if (job->preload) {
+		/* module init is done on main loop */
+		if (job->module && ug_module_init(job->module)) {
+			_ERR("ug_preload_list() failed: %s init failed\n",
+			     job->name);
+			ug_module_drop(job->module);
+			job->module = NULL;
+		}
+		job->preload->module = job->module;
+		job->preload->job = NULL;
+	} else if (job->module) {
+		ug_module_unload(job->module);
+	}
+
+	free((void *)job->name);
+	free(job);
+
+	if (!--list->pending)
+		ugman_preload_list_done(list);
+
+	return 0;
+}
+
+static void ugman_preload_thread(void *data, void *user_data)
+{
+	struct ug_preload_job *job = data;
+
+	/* path lookup and dlopen only, the handle is not touched here */
+	job->module = ug_module_open(job->name);
+	g_idle_add(ugman_preload_done, job);
+}
+
+int ugman_preload_list(const char **names, ug_preload_h *preloads, int n,
+		       void (*done_cb) (void *priv), void *priv)
+{
+	struct ug_preload_list *list;
+	struct ug_preload_job *job;
+	int i;
+
+	if (!ug_man.is_initted) {
+		_ERR("ug_preload_list() failed: manager is not initted\n");
+		return -1;
+	}
+
+	if (!ug_thread_pool_get(&ug_man.preloader, ugman_preload_thread,
+				UG_PRELOAD_THREADS)) {
+		_ERR("ug_preload_list() failed: no preload thread\n");
+		return -1;
+	}
+
+	list = calloc(1, sizeof(struct ug_preload_list));
+	if (!list) {
+		_ERR("ug_preload_list() failed: Memory allocation failed\n");
+		return -1;
+	}
 
-	return 0;
-}
+	list->done_cb = done_cb;
+	list->priv = priv;
+	/* held until every job is pushed */
+	list->pending = 1;
+
+	for (i = 0; i < n; i++) {
+		preloads[i] = calloc(1, sizeof(struct ug_preload_s));
+		if (preloads[i])
+			preloads[i]->name = strdup(names[i]);
+		if (!preloads[i] || !preloads[i]->name) {
+			free(preloads[i]);
+			preloads[i] = NULL;
+			break;
+		}
 
-static int ugman_ug_getopt(ui_gadget_h ug)
-{
-	if (!ug)
+		/* loaded by ug_create_preloaded() if skipped here */
+		if (ugman_ug_admit(names[i], 1))
+			continue;
+
+		job = calloc(1, sizeof(struct ug_preload_job));
+		if (job)
+			job->name = strdup(names[i]);
+		if (!job || !job->name) {
+			free(job);
+			/* preloads[i] is complete, it is released below */
+			i++;
+			break;
+		}
+
+		ugman_ug_prefetch(names[i]);
+
+		job->preload = preloads[i];
+		job->list = list;
+		preloads[i]->job = job;
+		list->pending++;
+		g_thread_pool_push(ug_man.preloader, job, NULL);
+	}
+
+	if (i < n) {
+		_ERR("ug_preload_list() failed: Memory allocation failed\n");
+		/* jobs in flight are canceled by the release */
+		while (i--) {
+			ugman_preload_release(preloads[i]);
+			preloads[i] = NULL;
+		}
+		list->done_cb = NULL;
+		if (!--list->pending)
+			free(list);
 		return -1;
-	/* Indicator Option */
-	if (ug->mode == UG_MODE_FULLVIEW)
-		ugman_indicator_update(UG_OPT_INDICATOR(ug->opt), UG_EVENT_NONE);
+	}
+
+	/* completion is always reported from the main loop */
+	if (!--list->pending)
+		g_idle_add(ugman_preload_list_done, list);
 
 	return 0;
 }
 
-static int ugman_ug_event(ui_gadget_h ug, enum ug_event event)
+int ugman_preload_release(ug_preload_h preload)
 {
-	struct ug_module_ops *ops = NULL;
-	GSList *child = NULL;
+	if (!preload) {
+		errno = EINVAL;
+		return -1;
+	}
 
-	if (!ug)
-		return 0;
+	if (preload->idle_id)
+		g_source_remove(preload->idle_id);
 
-	if (ug->children) {
-		child = ug->children;
-		while (child) {
-			ugman_ug_event(child->data, event);
-			child = g_slist_next(child);
-		}
-	}
+	/* the module being loaded goes to the module cache when done */
+	if (preload->job)
+		preload->job->preload = NULL;
 
-	if (ug->module)
-		ops = &ug->module->ops;
+	/* the module stays in the module cache for a while */
+	if (preload->module)
+		ug_module_unload(preload->module);
 
-	if (ops && ops->event)
-		ops->event(ug, event, ug->service, ops->priv);
+	free((void *)preload->name);
+	free(preload);
 
 	return 0;
 }
 
-static int ugman_ug_destroy(void *data)
+ui_gadget_h ugman_ug_load_preloaded(ui_gadget_h parent,
+				ug_preload_h preload,
+				enum ug_mode mode,
+				service_h service, struct ug_cbs *cbs)
 {
-	ui_gadget_h ug = data;
-	struct ug_module_ops *ops = NULL;
-	GSList *child, *trail;
+	struct ug_module *module;
 
-	job_start();
+	/* not loaded yet, do it now */
+	if (preload->idle_id) {
+		g_source_remove(preload->idle_id);
+		ugman_preload_idle(preload);
+	}
 
-	if (!ug)
-		goto end;
+	/*
+	 * ops->priv is per instance, so the first instance takes the
+	 * module over and later ones load their own
+	 */
+	if (preload->module) {
+		module = preload->module;
+		preload->module = NULL;
+		/* loaded ahead of time, nothing is loaded for this instance */
+		memset(module->timing, 0, sizeof(module->timing));
+	} else {
+		ugman_ug_admit(preload->name, 0);
+		module = ug_module_load(preload->name);
+	}
 
-	switch (ug->state) {
-	case UG_STATE_CREATED:
-	case UG_STATE_RUNNING:
-	case UG_STATE_STOPPED:
-	case UG_STATE_DESTROYING:
-		break;
-	default:
-		goto end;
+	if (!module) {
+		_ERR("ug_create_preloaded() failed: Module loading failed\n");
+		return NULL;
 	}
 
-	ug->state = UG_STATE_DESTROYED;
+	return ugman_ug_load_module(parent, preload->name, module, mode,
+				    service, cbs);
+}
 
-	if (ug->module)
-		ops = &ug->module->ops;
+static void ugman_load_job_free(struct ug_load_job *job)
+{
+	if (job->module)
+		ug_module_unload(job->module);
+	if (job->service)
+		service_destroy(job->service);
+	free((void *)job->name);
+	free(job);
+}
 
-	if (ug->children) {
-		child = ug->children;
-		while (child) {
-			trail = g_slist_next(child);
-			ugman_ug_destroy(child->data);
-			child = trail;
+static int ugman_ug_load_done(void *data)
+{
+	struct ug_load_job *job = data;
+	ui_gadget_h ug = job->ug;
+
+	if (!ug) {
+		/*
+		 * canceled or predicted, the module goes to the module cache.
+		 * predicted one is initialized here to make the next
+		 * creation as cheap as possible.
+		 */
+		if (job->predict) {
+			ug_man.predict_job = NULL;
+			if (job->module && ug_module_init(job->module)) {
+				_ERR("predicted %s init failed\n", job->name);
+				ug_module_drop(job->module);
+				job->module = NULL;
+			}
 		}
+		ugman_load_job_free(job);
+		return 0;
 	}
 
-	if (ops && ops->destroy)
-		ops->destroy(ug, ug->service, ops->priv);
+	if (job->failed) {
+		_ERR("%s failed: %s prepare failed\n", job->api, job->name);
+		ug->load_job = NULL;
+		ug_relation_del(ug);
+		goto load_fail;
+	}
 
-	ug_relation_del(ug);
+	if (!job->prepare) {
+		if (!job->module || ug_module_init(job->module)) {
+			_ERR("%s failed: Module loading failed\n", job->api);
+			ug_module_drop(job->module);
+			job->module = NULL;
+			ug->load_job = NULL;
+			ug_relation_del(ug);
+			goto load_fail;
+		}
 
-	if (ug->mode == UG_MODE_FULLVIEW) {
-		if (ug_man.fv_top == ug) {
-			ug_fvlist_del(ug);
-			ugman_ug_getopt(ug_man.fv_top);
-		} else {
-			ug_fvlist_del(ug);
+		/* prepare operation is known after the module init */
+		if (job->module->ops.prepare) {
+			job->prepare = 1;
+			service_clone(&job->service, ug->service);
+			g_thread_pool_push(ug_man.loader, job, NULL);
+			return 0;
 		}
 	}
 
-	ug_free(ug);
+	ug->load_job = NULL;
 
-	if (ug_man.root == ug)
-		ug_man.root = NULL;
+	ug->module = job->module;
+	job->module = NULL;
+	ug->opt = ug->module->ops.opt;
 
-	ugman_tree_dump(ug_man.root);
- end:
-	job_end();
+	ugman_ug_warm_up(job->name);
 
-	return 0;
-}
+	if (ugman_ug_create(ug) == -1)
+		goto load_fail;
 
-static void ug_hide_end_cb(ui_gadget_h ug)
-{
-	g_idle_add(ugman_ug_destroy, ug);
-}
+	if (ug->mode == UG_MODE_FULLVIEW)
+		ug_fvlist_add(ug);
 
-static int ugman_ug_create(void *data)
-{
-	ui_gadget_h ug = data;
-	struct ug_module_ops *ops = NULL;
-	struct ug_cbs *cbs;
-	struct ug_engine_ops *eng_ops = NULL;
+	if (job->done_cb)
+		job->done_cb(ug, job->priv);
+	ugman_load_job_free(job);
 
-	if (!ug || ug->state != UG_STATE_READY)
-		return -1;
+	return 0;
 
-	ug->state = UG_STATE_CREATED;
+ load_fail:
+	/* deferred ug_create() has returned the handle, tell its owner */
+	if (!job->done_cb && ug->cbs.destroy_cb)
+		ug->cbs.destroy_cb(ug, ug->cbs.priv);
+	ug_free(ug);
+	if (job->done_cb)
+		job->done_cb(NULL, job->priv);
+	ugman_load_job_free(job);
 
-	if (ug->module)
-		ops = &ug->module->ops;
+	return 0;
+}
 
-	if (ug_man.engine)
-		eng_ops = &ug_man.engine->ops;
+static void ugman_ug_load_thread(void *data, void *user_data)
+{
+	struct ug_load_job *job = data;
+	struct ug_module_ops *ops;
+
+	if (job->prepare) {
+		/* module's own setup, which does not touch the ug */
+		ops = &job->module->ops;
+		if (ops->prepare(job->service, ops->priv))
+			job->failed = 1;
+	} else {
+		/* path lookup and dlopen only, module init is done on main loop */
+		job->module = ug_module_open(job->name);
+	}
 
-	if (ops && ops->create) {
-		ug->layout = ops->create(ug, ug->mode, ug->service, ops->priv);
-		if (!ug->layout) {
-			ug_relation_del(ug);
-			return -1;
-		}
-		if (ug->mode == UG_MODE_FULLVIEW) {
-			if (eng_ops && eng_ops->create)
-				ug->effect_layout = eng_ops->create(ug_man.win, ug, ug_hide_end_cb);
-		}
-		cbs = &ug->cbs;
+	g_idle_add(ugman_ug_load_done, job);
+}
 
-		if (cbs && cbs->layout_cb)
-			cbs->layout_cb(ug, ug->mode, cbs->priv);
+static int ugman_ug_load_step(void *data)
+{
+	struct ug_load_job *job = data;
 
-		ugman_ug_getopt(ug);
+	if (!job->ug) {
+		/* destroyed before loading, never dlopened */
+		ugman_load_job_free(job);
+		return 0;
 	}
 
-	ugman_ug_event(ug, ug_man.last_rotate_evt);
-	ugman_ug_start(ug);
-	ugman_tree_dump(ug_man.root);
+	/* module creation is the next step, which could be canceled too */
+	job->module = ug_module_open(job->name);
+	g_idle_add(ugman_ug_load_done, job);
 
 	return 0;
 }
 
-int ugman_ug_add(ui_gadget_h parent, ui_gadget_h ug)
+static GThreadPool *ugman_loader_get(void)
 {
-	if (!ug_man.is_initted) {
-		_ERR("ugman_ug_add failed: manager is not initted\n");
-		return -1;
-	}
+	return ug_thread_pool_get(&ug_man.loader, ugman_ug_load_thread, 1);
+}
 
-	if (!ug_man.root) {
-		if (parent) {
-			_ERR("ugman_ug_add failed: parent has to be NULL w/o root\n");
-			errno = EINVAL;
-			return -1;
-		}
+static void ugman_predict(ui_gadget_h ug)
+{
+	struct ug_load_job *job;
+	const char *name;
 
-		ug_man.root = ug_root_create();
-		if (!ug_man.root)
-			return -1;
-		ug_man.root->opt = ug_man.base_opt;
-		ug_man.root->layout = ug_man.win;
-		ug_fvlist_add(ug_man.root);
-	}
+	/* one prediction at a time */
+	if (ug_man.predict_job)
+		return;
 
-	if (!parent)
-		parent = ug_man.root;
+	name = ug_history_predict(ug->name);
+	if (!name)
+		return;
 
-	if (ug_relation_add(parent, ug))
-		return -1;
+	/* an idle instance is waiting already, one is enough */
+	if (ug_module_cached(name))
+		return;
 
-	if (ugman_ug_create(ug) == -1)
-		return -1;
+	/* own pool, so that it never delays ug_create_async() */
+	if (ugman_ug_admit(name, 1)
+	    || !ug_thread_pool_get(&ug_man.predictor, ugman_ug_load_thread, 1))
+		return;
 
-	if (ug->mode == UG_MODE_FULLVIEW)
-		ug_fvlist_add(ug);
+	job = calloc(1, sizeof(struct ug_load_job));
+	if (!job)
+		return;
+
+	job->name = strdup(name);
+	if (!job->name) {
+		free(job);
+		return;
+	}
+	job->predict = 1;
 
+	_DBG("predicted %s after %s\n", name, ug->name);
+
+	ug_man.predict_job = job;
+	g_thread_pool_push(ug_man.predictor, job, NULL);
+}
+
+int ugman_set_prediction(int enable)
+{
+	ug_man.predict = !!enable;
 	return 0;
 }
 
-ui_gadget_h ugman_ug_load(ui_gadget_h parent,
+static ui_gadget_h ugman_ug_load_job(ui_gadget_h parent,
 				const char *name,
 				enum ug_mode mode,
-				service_h service, struct ug_cbs *cbs)
+				service_h service, struct ug_cbs *cbs,
+				void (*done_cb) (ui_gadget_h ug, void *priv),
+				int deferred)
 {
-	int r;
 	ui_gadget_h ug;
+	struct ug_load_job *job;
+	struct ug_manifest *manifest;
+	const char *api = deferred ? "ug_create()" : "ug_create_async()";
 
-	ug = calloc(1, sizeof(struct ui_gadget_s));
-	if (!ug) {
-		_ERR("ug_create() failed: Memory allocation failed\n");
+	if (!ugman_loader_get()) {
+		_ERR("%s failed: no loader thread\n", api);
 		return NULL;
 	}
 
-	ug->module = ug_module_load(name);
-	if (!ug->module) {
-		_ERR("ug_create() failed: Module loading failed\n");
-		goto load_fail;
+	job = calloc(1, sizeof(struct ug_load_job));
+	if (!job) {
+		_ERR("%s failed: Memory allocation failed\n", api);
+		return NULL;
 	}
 
-	ug->name = strdup(name);
+	ug = ug_alloc(name);
+	if (!ug) {
+		_ERR("%s failed: Memory allocation failed\n", api);
+		free(job);
+		return NULL;
+	}
 
+	job->name = strdup(name);
+	job->api = api;
 	ug->mode = mode;
 	service_clone(&ug->service, service);
-	ug->opt = ug->module->ops.opt;
 	ug->state = UG_STATE_READY;
-	ug->children = NULL;
 
-	if (cbs)
+	if (cbs) {
 		memcpy(&ug->cbs, cbs, sizeof(struct ug_cbs));
+		job->priv = cbs->priv;
+	}
 
-	r = ugman_ug_add(parent, ug);
-	if (r) {
-		_ERR("ug_create() failed: Tree update failed\n");
-		goto load_fail;
+	job->ug = ug;
+	job->done_cb = done_cb;
+	ug->load_job = job;
+
+	/* the pending ug is in the tree, so that it can be destroyed */
+	if (!job->name || ugman_ug_attach(parent, ug)) {
+		_ERR("%s failed: Tree update failed\n", api);
+		ugman_load_job_free(job);
+		ug->load_job = NULL;
+		ug_free(ug);
+		return NULL;
 	}
 
-	return ug;
+	ugman_ug_admit(name, 0);
+	ugman_ug_prefetch(name);
 
- load_fail:
-	ug_free(ug);
-	return NULL;
+	/* indicator can be arranged before the module is loaded */
+	manifest = ug_module_manifest_get(name);
+	if (manifest && manifest->has_opt) {
+		ug->opt = manifest->opt;
+		ugman_ug_getopt(ug);
+	}
+	ug_module_manifest_free(manifest);
+
+	if (deferred)
+		g_idle_add(ugman_ug_load_step, job);
+	else
+		g_thread_pool_push(ug_man.loader, job, NULL);
+
+	return ug;
 }
 
-int ugman_ug_destroying(ui_gadget_h ug)
+ui_gadget_h ugman_ug_load_async(ui_gadget_h parent,
+				const char *name,
+				enum ug_mode mode,
+				service_h service, struct ug_cbs *cbs,
+				void (*done_cb) (ui_gadget_h ug, void *priv))
 {
-	struct ug_module_ops *ops = NULL;
-	GSList *child, *trail;
+	return ugman_ug_load_job(parent, name, mode, service, cbs, done_cb, 0);
+}
 
+static enum ug_walk_ret ugman_ug_destroying_pre(ui_gadget_h ug, int depth,
+						void *data)
+{
 	ug->destroy_me = 1;
 	ug->state = UG_STATE_DESTROYING;
 
+	ugman_ug_load_cancel(ug);
+	ugman_ug_populate_cancel(ug);
+
+	return UG_WALK_CONTINUE;
+}
+
+static void ugman_ug_destroying_post(ui_gadget_h ug, int depth, void *data)
+{
+	struct ug_module_ops *ops = NULL;
+
 	if (ug->module)
 		ops = &ug->module->ops;
 
-	if (ug->children) {
-		child = ug->children;
-		while (child) {
-			trail = g_slist_next(child);
-			ugman_ug_destroying(child->data);
-			child = trail;
-		}
-	}
-
 	if (ops && ops->destroying)
 		ops->destroying(ug, ug->service, ops->priv);
+}
+
+int ugman_ug_destroying(ui_gadget_h ug)
+{
+	ug_walk(ug, ugman_ug_destroying_pre, ugman_ug_destroying_post, NULL);
 
 	return 0;
 }
@@ -548,6 +1577,7 @@ int ugman_ug_destroying(ui_gadget_h ug)
 int ugman_ug_del(ui_gadget_h ug)
 {
 	struct ug_engine_ops *eng_ops = NULL;
+	int prepared;
 
 	if (!ug || !ugman_ug_exist(ug) || ug->state == UG_STATE_DESTROYED) {
 		_ERR("ugman_ug_del failed: Invalid ug\n");
@@ -570,13 +1600,24 @@ int ugman_ug_del(ui_gadget_h ug)
 		return -1;
 	}
 
+	if (ug->load_job) {
+		/* module is not loaded yet, nothing to show or hide */
+		ugman_ug_load_cancel(ug);
+		ugman_ug_destroying(ug);
+		g_idle_add(ugman_ug_destroy, ug);
+		return 0;
+	}
+
+	/* prepared one has never been shown, so no hide effect */
+	prepared = ug->state == UG_STATE_PREPARED;
+
 	ugman_ug_destroying(ug);
 
 	if (ug_man.engine)
 		eng_ops = &ug_man.engine->ops;
 
 	if (eng_ops && eng_ops->destroy)
-		if (ug->mode == UG_MODE_FULLVIEW)
+		if (ug->mode == UG_MODE_FULLVIEW && !prepared)
 			eng_ops->destroy(ug, ug_man.fv_top);
 		else {
 			eng_ops->destroy(ug, NULL);
@@ -609,8 +1650,48 @@ int ugman_ug_del_all(void)
 	return 0;
 }
 
+static void ugman_exit(void)
+{
+	/*
+	 * no UG_MODULE_EXIT here, the UI toolkit may be gone already.
+	 * modules are torn down when the root is destroyed, the ones
+	 * still pending at process exit are left to the OS.
+	 */
+	ug_history_save();
+}
+
+static int ugman_readahead(void *data)
+{
+	static int index;
+	const char *names[UG_READAHEAD_MAX];
+	char path[PATH_MAX];
+	int n;
+
+	n = ug_history_top(names, UG_READAHEAD_MAX);
+	if (index >= n) {
+		ug_man.readahead_id = 0;
+		return 0;
+	}
+
+	/* one module per idle iteration, not to delay the first frame */
+	if (!ug_module_path_get(names[index], path, sizeof(path))) {
+		ugman_file_readahead(path);
+		_DBG("readahead %s\n", path);
+	}
+
+	index++;
+	return 1;
+}
+
 int ugman_init(Display *disp, Window xid, void *win, enum ug_option opt)
 {
+	if (!ug_man.is_initted) {
+		/* worker pools are created later, on the main loop */
+		if (!g_thread_supported())
+			g_thread_init(NULL);
+		atexit(ugman_exit);
+	}
+
 	ug_man.is_initted = 1;
 	ug_man.win = win;
 	ug_man.disp = disp;
@@ -618,6 +1699,13 @@ int ugman_init(Display *disp, Window xid, void *win, enum ug_option opt)
 	ug_man.base_opt = opt;
 	ug_man.last_rotate_evt = UG_EVENT_ROTATE_PORTRAIT;
 	ug_man.engine = ug_engine_load();
+	ug_man.init_time = g_get_monotonic_time();
+
+	ug_history_load();
+	if (!ug_man.readahead_id)
+		ug_man.readahead_id = g_idle_add_full(G_PRIORITY_LOW,
+						      ugman_readahead,
+						      NULL, NULL);
 
 	return 0;
 }
@@ -658,11 +1746,30 @@ int ugman_pause(void)
 	return 0;
 }
 
+static enum ug_walk_ret ugman_ug_reclaim_pre(ui_gadget_h ug, int depth,
+					     void *data)
+{
+	if (ug->state != UG_STATE_PREPARED || ug->destroy_me)
+		return UG_WALK_CONTINUE;
+
+	/* destroyed on idle along with its children */
+	_DBG("reclaim prepared ug %s\n", ug->name);
+	ugman_ug_del(ug);
+
+	return UG_WALK_SKIP;
+}
+
+static void ugman_ug_reclaim_prepared(ui_gadget_h ug)
+{
+	if (ug)
+		ug_walk(ug, ugman_ug_reclaim_pre, NULL, NULL);
+}
+
 static int ugman_send_event_pre(void *data)
 {
 	job_start();
 
-	ugman_ug_event(ug_man.root, (enum ug_event)data);
+	ugman_event_dispatch((enum ug_event)data);
 
 	job_end();
 
@@ -691,6 +1798,12 @@ int ugman_send_event(enum ug_event event)
 		ug_man.last_rotate_evt = event;
 		ug_man.is_landscape = 1;
 		break;
+	case UG_EVENT_LOW_MEMORY:
+		ug_man.low_memory_time = g_get_monotonic_time();
+		ug_module_cache_flush();
+		ugman_ug_reclaim_prepared(ug_man.root);
+		is_rotation = 0;
+		break;
 	default:
 		is_rotation = 0;
 	}
@@ -795,7 +1908,16 @@ static inline void job_end(void)
 		ug_man.walking = 0;
 }
 
+int ugman_get_fullview_depth(void)
+{
+	return ug_man.fv_depth;
+}
+
+/* reliable as long as freed nodes are not reused, see ug_free() */
 int ugman_ug_exist(ui_gadget_h ug)
 {
-	return ugman_ug_find(ug_man.root, ug);
+	if (!ug || !ug_man.live)
+		return 0;
+
+	return g_hash_table_lookup(ug_man.live, ug) != NULL;
 }
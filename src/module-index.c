@@ -0,0 +1,400 @@
+/*
+ *  UI Gadget
+ *
+ * Copyright (c) 2000 - 2011 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * Contact: Jayoun Lee <airjany@samsung.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include <linux/limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <glib.h>
+
+#include "ug-module-index.h"
+#include "ug-dbg.h"
+
+/*
+ * The index is a small text file which is mmap'ed read-only:
+ *
+ *   UGIDX 1
+ *   D <mtime sec> <mtime nsec> <search dir>	(one line per search dir)
+ *   <name>\t<path>			(one line per module, sorted by name)
+ *
+ * It is rebuilt whenever the mtime of one of the search dirs changed, and
+ * kept in the home dir so that it survives reboots.
+ */
+#define UG_MODULE_INDEX_MAGIC "UGIDX 1\n"
+#define UG_MODULE_PREFIX "libug-"
+#define UG_MODULE_SUFFIX ".so"
+
+struct ug_module_index {
+	char *map;
+	size_t size;
+	/* entries start here */
+	const char *entries;
+	int checked;
+};
+
+static struct ug_module_index ug_index;
+G_LOCK_DEFINE_STATIC(ug_index);
+
+int ug_module_dirs_get(char dirs[][PATH_MAX], int max)
+{
+	char *pkg_name;
+	int n = 0;
+
+	if (max < UG_MODULE_DIR_MAX)
+		return -1;
+
+	pkg_name = getenv("PKG_NAME");
+	if (pkg_name) {
+		snprintf(dirs[n++], PATH_MAX, "/usr/apps/%s/lib", pkg_name);
+		snprintf(dirs[n++], PATH_MAX, "/opt/apps/%s/lib", pkg_name);
+	}
+	snprintf(dirs[n++], PATH_MAX, "/usr/ug/lib");
+	snprintf(dirs[n++], PATH_MAX, "/opt/ug/lib");
+
+	return n;
+}
+
+static int get_index_path(char *path, int len)
+{
+	char *dir;
+	char *pkg_name;
+
+	/* no shared fallback, the index is simply not used */
+	dir = getenv("HOME");
+	if (!dir || !*dir)
+		return -1;
+
+	pkg_name = getenv("PKG_NAME");
+	snprintf(path, len, "%s/.ug-module-index.%s", dir,
+		 pkg_name ? pkg_name : "-");
+
+	return 0;
+}
+
+static void get_dir_mtime(const char *dir, long *sec, long *nsec)
+{
+	struct stat st;
+
+	if (stat(dir, &st)) {
+		*sec = -1;
+		*nsec = -1;
+		return;
+	}
+
+	*sec = st.st_mtim.tv_sec;
+	*nsec = st.st_mtim.tv_nsec;
+}
+
+void ug_module_dirs_stamp_get(struct ug_module_dirs_stamp *stamp)
+{
+	char dirs[UG_MODULE_DIR_MAX][PATH_MAX];
+	int i;
+
+	memset(stamp, 0, sizeof(*stamp));
+	stamp->count = ug_module_dirs_get(dirs, UG_MODULE_DIR_MAX);
+	for (i = 0; i < stamp->count; i++)
+		get_dir_mtime(dirs[i], &stamp->mtime[i][0], &stamp->mtime[i][1]);
+}
+
+static void index_unmap(void)
+{
+	if (ug_index.map)
+		munmap(ug_index.map, ug_index.size);
+	memset(&ug_index, 0, sizeof(ug_index));
+}
+
+static int index_map(void)
+{
+	char path[PATH_MAX];
+	struct stat st;
+	void *map;
+	int fd;
+
+	if (get_index_path(path, sizeof(path)))
+		return -1;
+
+	fd = open(path, O_RDONLY | O_NOFOLLOW);
+	if (fd < 0)
+		return -1;
+
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_uid != geteuid()
+	    || st.st_size <= (off_t)strlen(UG_MODULE_INDEX_MAGIC)) {
+		close(fd);
+		return -1;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return -1;
+
+	ug_index.map = map;
+	ug_index.size = st.st_size;
+
+	return 0;
+}
+
+/* returns 1 if the mapped index matches the current search dirs */
+static int index_is_fresh(void)
+{
+	char dirs[UG_MODULE_DIR_MAX][PATH_MAX];
+	/* "D <sec> <nsec> <dir>" */
+	char line[PATH_MAX + 64];
+	const char *p, *end, *nl;
+	long sec, nsec, cur_sec, cur_nsec;
+	int i, n, off;
+
+	p = ug_index.map;
+	end = ug_index.map + ug_index.size;
+
+	if (strncmp(p, UG_MODULE_INDEX_MAGIC, strlen(UG_MODULE_INDEX_MAGIC)))
+		return 0;
+	p += strlen(UG_MODULE_INDEX_MAGIC);
+
+	n = ug_module_dirs_get(dirs, UG_MODULE_DIR_MAX);
+	for (i = 0; i < n; i++) {
+		nl = memchr(p, '\n', end - p);
+		if (!nl || *p != 'D' || nl - p >= (int)sizeof(line))
+			return 0;
+		/* the map is not NUL terminated, parse a bounded copy */
+		memcpy(line, p, nl - p);
+		line[nl - p] = '\0';
+		if (sscanf(line, "D %ld %ld %n", &sec, &nsec, &off) != 2)
+			return 0;
+		if (strcmp(line + off, dirs[i]))
+			return 0;
+		get_dir_mtime(dirs[i], &cur_sec, &cur_nsec);
+		if (sec != cur_sec || nsec != cur_nsec)
+			return 0;
+		p = nl + 1;
+	}
+
+	if (p < end && *p == 'D')
+		return 0;
+
+	ug_index.entries = p;
+	return 1;
+}
+
+static gboolean write_entry(gpointer key, gpointer value, gpointer data)
+{
+	fprintf((FILE *)data, "%s\t%s\n", (char *)key, (char *)value);
+	return FALSE;
+}
+
+static int index_build(void)
+{
+	char dirs[UG_MODULE_DIR_MAX][PATH_MAX];
+	char path[PATH_MAX];
+	char tmp[PATH_MAX];
+	GTree *modules;
+	DIR *dir;
+	struct dirent *ent;
+	FILE *file;
+	long sec, nsec;
+	size_t len, plen, slen;
+	int i, n, fd;
+
+	if (get_index_path(path, sizeof(path)))
+		return -1;
+
+	n = ug_module_dirs_get(dirs, UG_MODULE_DIR_MAX);
+	snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path);
+
+	fd = mkstemp(tmp);
+	if (fd < 0) {
+		_ERR("module index: mkstemp failed: %s\n", strerror(errno));
+		return -1;
+	}
+
+	file = fdopen(fd, "w");
+	if (!file) {
+		close(fd);
+		unlink(tmp);
+		return -1;
+	}
+
+	modules = g_tree_new_full((GCompareDataFunc)strcmp, NULL, g_free, g_free);
+	plen = strlen(UG_MODULE_PREFIX);
+	slen = strlen(UG_MODULE_SUFFIX);
+
+	fputs(UG_MODULE_INDEX_MAGIC, file);
+	for (i = 0; i < n; i++) {
+		/* take the mtime first so that a racing install marks it stale */
+		get_dir_mtime(dirs[i], &sec, &nsec);
+		fprintf(file, "D %ld %ld %s\n", sec, nsec, dirs[i]);
+
+		dir = opendir(dirs[i]);
+		if (!dir)
+			continue;
+
+		while ((ent = readdir(dir))) {
+			len = strlen(ent->d_name);
+			if (len <= plen + slen
+			    || strncmp(ent->d_name, UG_MODULE_PREFIX, plen)
+			    || strcmp(ent->d_name + len - slen, UG_MODULE_SUFFIX))
+				continue;
+
+			ent->d_name[len - slen] = '\0';
+			/* earlier search dirs take precedence */
+			if (g_tree_lookup(modules, ent->d_name + plen))
+				continue;
+			ent->d_name[len - slen] = '.';
+
+			g_tree_insert(modules,
+				      g_strndup(ent->d_name + plen,
+						len - plen - slen),
+				      g_strdup_printf("%s/%s", dirs[i],
+						      ent->d_name));
+		}
+		closedir(dir);
+	}
+	g_tree_foreach(modules, write_entry, file);
+	g_tree_destroy(modules);
+
+	if (fclose(file) || rename(tmp, path)) {
+		_ERR("module index: write failed: %s\n", strerror(errno));
+		unlink(tmp);
+		return -1;
+	}
+
+	_DBG("module index: rebuilt %s\n", path);
+	return 0;
+}
+
+static int index_prepare(void)
+{
+	if (ug_index.map && ug_index.checked)
+		return 0;
+
+	if (!ug_index.map)
+		index_map();
+
+	if (ug_index.map && index_is_fresh()) {
+		ug_index.checked = 1;
+		return 0;
+	}
+
+	index_unmap();
+	if (index_build() || index_map() || !index_is_fresh()) {
+		index_unmap();
+		return -1;
+	}
+
+	ug_index.checked = 1;
+	return 0;
+}
+
+static int index_find(const char *name, char *path, int len)
+{
+	const char *p, *end, *tab, *nl;
+	size_t name_len;
+
+	name_len = strlen(name);
+	p = ug_index.entries;
+	end = ug_index.map + ug_index.size;
+
+	while (p < end) {
+		nl = memchr(p, '\n', end - p);
+		if (!nl)
+			break;
+		tab = memchr(p, '\t', nl - p);
+		if (tab && (size_t)(tab - p) == name_len
+		    && !strncmp(p, name, name_len)) {
+			if (nl - tab - 1 >= len)
+				return -1;
+			memcpy(path, tab + 1, nl - tab - 1);
+			path[nl - tab - 1] = '\0';
+			return 0;
+		}
+		p = nl + 1;
+	}
+
+	return -1;
+}
+
+static int index_lookup(const char *name, char *path, int len)
+{
+	if (index_prepare()) {
+		errno = EAGAIN;
+		return -1;
+	}
+
+	if (!index_find(name, path, len))
+		return 0;
+
+	/* not in a verified index: make sure nothing was installed since */
+	if (index_is_fresh()) {
+		errno = ENOENT;
+		return -1;
+	}
+
+	ug_index.checked = 0;
+	if (index_prepare()) {
+		errno = EAGAIN;
+		return -1;
+	}
+
+	if (!index_find(name, path, len))
+		return 0;
+
+	errno = ENOENT;
+	return -1;
+}
+
+int ug_module_index_lookup(const char *name, char *path, int len)
+{
+	int r;
+	int err;
+
+	if (!name || !path) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* module loading may run on a worker thread */
+	G_LOCK(ug_index);
+	r = index_lookup(name, path, len);
+	err = errno;
+	G_UNLOCK(ug_index);
+
+	errno = err;
+	return r;
+}
+
+void ug_module_index_invalidate(void)
+{
+	char path[PATH_MAX];
+
+	G_LOCK(ug_index);
+	index_unmap();
+	if (!get_index_path(path, sizeof(path)))
+		unlink(path);
+	G_UNLOCK(ug_index);
+}
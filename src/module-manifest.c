@@ -0,0 +1,184 @@
+/*
+ *  UI Gadget
+ *
+ * Copyright (c) 2000 - 2011 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * Contact: Jayoun Lee <airjany@samsung.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include <linux/limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <glib.h>
+
+#include "ug-module.h"
+#include "ug-module-manifest.h"
+#include "ug-dbg.h"
+
+#define UG_MANIFEST_GROUP "UG"
+#define UG_MANIFEST_SUFFIX ".manifest"
+
+static const struct {
+	const char *name;
+	enum ug_option opt;
+} indicator_tbl[] = {
+	{ "enable", UG_OPT_INDICATOR_ENABLE },
+	{ "portrait", UG_OPT_INDICATOR_PORTRAIT_ONLY },
+	{ "landscape", UG_OPT_INDICATOR_LANDSCAPE_ONLY },
+	{ "disable", UG_OPT_INDICATOR_DISABLE },
+};
+
+/* name -> struct ug_manifest, or the name only if there is no manifest */
+static GHashTable *ug_manifests;
+G_LOCK_DEFINE_STATIC(ug_manifests);
+
+static void manifest_free(void *data)
+{
+	struct ug_manifest *manifest = data;
+
+	if (!manifest)
+		return;
+
+	g_strfreev(manifest->resources);
+	free(manifest);
+}
+
+static void manifest_parse(GKeyFile *kf, struct ug_manifest *manifest)
+{
+	char *str;
+	int i;
+
+	str = g_key_file_get_string(kf, UG_MANIFEST_GROUP, "Indicator", NULL);
+	if (str) {
+		for (i = 0; i < G_N_ELEMENTS(indicator_tbl); i++) {
+			if (!strcmp(str, indicator_tbl[i].name)) {
+				manifest->opt = indicator_tbl[i].opt;
+				manifest->has_opt = 1;
+				break;
+			}
+		}
+		if (!manifest->has_opt)
+			_ERR("manifest: unknown indicator option %s\n", str);
+		g_free(str);
+	}
+
+	manifest->memory = g_key_file_get_integer(kf, UG_MANIFEST_GROUP,
+						  "Memory", NULL);
+	if (manifest->memory < 0)
+		manifest->memory = 0;
+
+	manifest->resources = g_key_file_get_string_list(kf, UG_MANIFEST_GROUP,
+							 "Resources", NULL,
+							 NULL);
+}
+
+static struct ug_manifest *manifest_load(const char *name)
+{
+	struct ug_manifest *manifest;
+	char path[PATH_MAX];
+	GKeyFile *kf;
+	int len;
+
+	if (ug_module_path_get(name, path, sizeof(path)))
+		return NULL;
+
+	/* libug-<name>.so -> libug-<name>.manifest */
+	len = strlen(path);
+	if (len < 3 || strcmp(path + len - 3, ".so"))
+		return NULL;
+	path[len - 3] = '\0';
+	if (len - 3 + strlen(UG_MANIFEST_SUFFIX) >= sizeof(path))
+		return NULL;
+	strcat(path, UG_MANIFEST_SUFFIX);
+
+	kf = g_key_file_new();
+	if (!g_key_file_load_from_file(kf, path, G_KEY_FILE_NONE, NULL)) {
+		g_key_file_free(kf);
+		return NULL;
+	}
+
+	manifest = calloc(1, sizeof(struct ug_manifest));
+	if (manifest)
+		manifest_parse(kf, manifest);
+
+	g_key_file_free(kf);
+
+	return manifest;
+}
+
+static struct ug_manifest *manifest_dup(const struct ug_manifest *manifest)
+{
+	struct ug_manifest *dup;
+
+	dup = malloc(sizeof(struct ug_manifest));
+	if (!dup) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	*dup = *manifest;
+	dup->resources = g_strdupv(manifest->resources);
+
+	return dup;
+}
+
+struct ug_manifest *ug_module_manifest_get(const char *name)
+{
+	struct ug_manifest *manifest;
+	gpointer value;
+
+	if (!name) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	G_LOCK(ug_manifests);
+
+	if (!ug_manifests)
+		ug_manifests = g_hash_table_new_full(g_str_hash, g_str_equal,
+						     g_free, manifest_free);
+
+	if (g_hash_table_lookup_extended(ug_manifests, name, NULL, &value)) {
+		manifest = value;
+	} else {
+		/* a missing manifest is cached as well */
+		manifest = manifest_load(name);
+		g_hash_table_insert(ug_manifests, g_strdup(name), manifest);
+	}
+
+	/* the cached one could be flushed at any time */
+	if (manifest)
+		manifest = manifest_dup(manifest);
+
+	G_UNLOCK(ug_manifests);
+
+	return manifest;
+}
+
+void ug_module_manifest_free(struct ug_manifest *manifest)
+{
+	manifest_free(manifest);
+}
+
+void ug_module_manifest_flush(void)
+{
+	G_LOCK(ug_manifests);
+	if (ug_manifests)
+		g_hash_table_remove_all(ug_manifests);
+	G_UNLOCK(ug_manifests);
+}
@@ -27,13 +27,61 @@
 #include <dlfcn.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <glib.h>
 
+#include "ug.h"
 #include "ug-module.h"
+#include "ug-module-index.h"
 #include "ug-dbg.h"
 
 #define UG_MODULE_INIT_SYM "UG_MODULE_INIT"
 #define UG_MODULE_EXIT_SYM "UG_MODULE_EXIT"
 
+/* maximum number of released modules kept loaded for reuse */
+#define UG_MODULE_CACHE_MAX 4
+
+struct ug_module_cache {
+	/* name -> GSList of released modules */
+	GHashTable *idle;
+	/* released modules, most recently used first */
+	GQueue lru;
+};
+
+static struct ug_module_cache ug_cache;
+G_LOCK_DEFINE_STATIC(ug_cache);
+
+/* how often search dirs are checked for newly installed modules (usec) */
+#define UG_MODULE_MISSING_CHECK_INTERVAL (1000 * 1000)
+
+struct ug_module_missing {
+	/* names of modules which are not installed */
+	GHashTable *names;
+	/* search dirs when the names were recorded */
+	struct ug_module_dirs_stamp stamp;
+	gint64 checked;
+};
+
+static struct ug_module_missing ug_missing;
+G_LOCK_DEFINE_STATIC(ug_missing);
+
+struct ug_module_teardown {
+	/* evicted modules waiting for UG_MODULE_EXIT */
+	GQueue pending;
+	unsigned int idle_id;
+	GThreadPool *closer;
+};
+
+static struct ug_module_teardown ug_teardown = { G_QUEUE_INIT, 0, NULL };
+
+struct ug_module_entry {
+	int (*init) (struct ug_module_ops *ops);
+	void (*exit) (struct ug_module_ops *ops);
+};
+
+/* name -> struct ug_module_entry of modules linked into the process */
+static GHashTable *ug_registry;
+G_LOCK_DEFINE_STATIC(ug_registry);
+
 static int file_exist(const char *filename)
 {
 	FILE *file;
@@ -45,58 +93,459 @@ static int file_exist(const char *filename)
 	return 0;
 }
 
-struct ug_module *ug_module_load(const char *name)
+int ug_module_register(const char *name,
+			int (*init) (struct ug_module_ops *ops),
+			void (*exit) (struct ug_module_ops *ops))
 {
-	void *handle;
-	struct ug_module *module;
-	char ug_file[PATH_MAX];
+	struct ug_module_entry *entry;
 
-	char *pkg_name = NULL;
-	uid_t uid;
+	if (!name || !init) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	entry = calloc(1, sizeof(struct ug_module_entry));
+	if (!entry) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	entry->init = init;
+	entry->exit = exit;
 
-	int (*module_init) (struct ug_module_ops *ops);
+	G_LOCK(ug_registry);
+	if (!ug_registry)
+		ug_registry = g_hash_table_new_full(g_str_hash, g_str_equal,
+						    g_free, free);
+	g_hash_table_replace(ug_registry, g_strdup(name), entry);
+	G_UNLOCK(ug_registry);
 
-	module = calloc(1, sizeof(struct ug_module));
+	return 0;
+}
 
+static struct ug_module *ug_module_registry_get(const char *name)
+{
+	struct ug_module_entry *entry = NULL;
+	struct ug_module_entry found;
+	struct ug_module *module;
+
+	G_LOCK(ug_registry);
+	if (ug_registry)
+		entry = g_hash_table_lookup(ug_registry, name);
+	if (entry)
+		found = *entry;
+	G_UNLOCK(ug_registry);
+
+	if (!entry)
+		return NULL;
+
+	module = g_slice_new0(struct ug_module);
 	if (!module) {
 		errno = ENOMEM;
 		return NULL;
 	}
 
-	pkg_name = getenv("PKG_NAME");
-	uid = geteuid();
+	module->module_name = strdup(name);
+	if (!module->module_name) {
+		g_slice_free(struct ug_module, module);
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	module->init = found.init;
+	module->exit = found.exit;
+
+	return module;
+}
+
+static int ug_module_missing_find(const char *name)
+{
+	struct ug_module_dirs_stamp stamp;
+	gint64 now;
+	int r = 0;
+
+	G_LOCK(ug_missing);
 
-	do {
-		if (pkg_name) {
-			snprintf(ug_file, PATH_MAX, "/usr/apps/%s/lib/libug-%s.so", pkg_name, name);
-			if (file_exist(ug_file))
-				break;
-			snprintf(ug_file, PATH_MAX, "/opt/apps/%s/lib/libug-%s.so", pkg_name, name);
-			if (file_exist(ug_file))
-				break;
+	if (!ug_missing.names || !g_hash_table_lookup(ug_missing.names, name))
+		goto end;
+
+	now = g_get_monotonic_time();
+	if (now - ug_missing.checked > UG_MODULE_MISSING_CHECK_INTERVAL) {
+		ug_module_dirs_stamp_get(&stamp);
+		ug_missing.checked = now;
+		if (memcmp(&stamp, &ug_missing.stamp, sizeof(stamp))) {
+			/* something was installed or removed */
+			g_hash_table_remove_all(ug_missing.names);
+			goto end;
 		}
-		snprintf(ug_file, PATH_MAX, "/usr/ug/lib/libug-%s.so", name);
-		if (file_exist(ug_file))
-			break;
-		snprintf(ug_file, PATH_MAX, "/opt/ug/lib/libug-%s.so", name);
+	}
+
+	r = 1;
+ end:
+	G_UNLOCK(ug_missing);
+	return r;
+}
+
+static void ug_module_missing_add(const char *name)
+{
+	G_LOCK(ug_missing);
+
+	if (!ug_missing.names)
+		ug_missing.names = g_hash_table_new_full(g_str_hash,
+							 g_str_equal,
+							 g_free, NULL);
+
+	if (!g_hash_table_size(ug_missing.names)) {
+		ug_module_dirs_stamp_get(&ug_missing.stamp);
+		ug_missing.checked = g_get_monotonic_time();
+	}
+
+	g_hash_table_replace(ug_missing.names, g_strdup(name),
+			     GINT_TO_POINTER(1));
+
+	G_UNLOCK(ug_missing);
+}
+
+static int ug_module_resolve(const char *name, char *ug_file, int len,
+			     int use_index)
+{
+	char dirs[UG_MODULE_DIR_MAX][PATH_MAX];
+	int i, n;
+
+	if (use_index) {
+		if (!ug_module_index_lookup(name, ug_file, len))
+			return 0;
+		if (errno == ENOENT)
+			return -1;
+	}
+
+	/* index is not available, probe search dirs in order */
+	n = ug_module_dirs_get(dirs, UG_MODULE_DIR_MAX);
+	for (i = 0; i < n; i++) {
+		snprintf(ug_file, len, "%s/libug-%s.so", dirs[i], name);
 		if (file_exist(ug_file))
+			return 0;
+	}
+
+	errno = ENOENT;
+	return -1;
+}
+
+int ug_module_path_get(const char *name, char *path, int len)
+{
+	if (ug_module_missing_find(name)) {
+		errno = ENOENT;
+		return -1;
+	}
+
+	return ug_module_resolve(name, path, len, 1);
+}
+
+int ug_module_cached(const char *name)
+{
+	int found = 0;
+
+	G_LOCK(ug_cache);
+	if (ug_cache.idle)
+		found = !!g_hash_table_lookup(ug_cache.idle, name);
+	G_UNLOCK(ug_cache);
+
+	return found;
+}
+
+int ug_module_exist(const char *name)
+{
+	char ug_file[PATH_MAX];
+	int found = 0;
+
+	G_LOCK(ug_registry);
+	if (ug_registry)
+		found = !!g_hash_table_lookup(ug_registry, name);
+	G_UNLOCK(ug_registry);
+
+	if (found)
+		return 1;
+
+	if (ug_module_cached(name))
+		return 1;
+
+	if (ug_module_path_get(name, ug_file, sizeof(ug_file))) {
+		ug_module_missing_add(name);
+		return 0;
+	}
+
+	return 1;
+}
+
+static void ug_module_exit(struct ug_module *module)
+{
+	void (*module_exit) (struct ug_module_ops *ops);
+
+	if (!module->initted)
+		return;
+
+	module_exit = module->exit;
+	if (!module_exit && module->handle) {
+		module_exit = dlsym(module->handle, UG_MODULE_EXIT_SYM);
+		if (!module_exit)
+			_ERR("dlsym failed: %s\n", dlerror());
+	}
+	if (module_exit)
+		module_exit(&module->ops);
+
+	module->initted = 0;
+}
+
+static void ug_module_close(struct ug_module *module)
+{
+	if (module->handle)
+		dlclose(module->handle);
+
+	free((void *)module->module_name);
+	g_slice_free(struct ug_module, module);
+}
+
+static void ug_module_free(struct ug_module *module)
+{
+	ug_module_exit(module);
+	ug_module_close(module);
+}
+
+static void ug_module_close_thread(void *data, void *user_data)
+{
+	ug_module_close(data);
+}
+
+static int ug_module_teardown_idle(void *data)
+{
+	struct ug_module *module;
+
+	module = g_queue_pop_head(&ug_teardown.pending);
+	if (!module) {
+		ug_teardown.idle_id = 0;
+		return 0;
+	}
+
+	/* UG_MODULE_EXIT may touch the UI, so it stays on the main loop */
+	ug_module_exit(module);
+
+	if (module->handle
+	    && ug_thread_pool_get(&ug_teardown.closer, ug_module_close_thread, 1))
+		g_thread_pool_push(ug_teardown.closer, module, NULL);
+	else
+		ug_module_close(module);
+
+	if (g_queue_is_empty(&ug_teardown.pending)) {
+		ug_teardown.idle_id = 0;
+		return 0;
+	}
+
+	return 1;
+}
+
+/* tears down the module at low priority idle, dlclose on a thread */
+static void ug_module_free_deferred(struct ug_module *module)
+{
+	g_queue_push_tail(&ug_teardown.pending, module);
+
+	if (!ug_teardown.idle_id)
+		ug_teardown.idle_id = g_idle_add_full(G_PRIORITY_LOW,
+						      ug_module_teardown_idle,
+						      NULL, NULL);
+}
+
+void ug_module_teardown_flush(void)
+{
+	struct ug_module *module;
+
+	if (ug_teardown.idle_id) {
+		g_source_remove(ug_teardown.idle_id);
+		ug_teardown.idle_id = 0;
+	}
+
+	while ((module = g_queue_pop_head(&ug_teardown.pending)))
+		ug_module_free(module);
+
+	/* wait for dlclose in progress */
+	if (ug_teardown.closer) {
+		g_thread_pool_free(ug_teardown.closer, FALSE, TRUE);
+		ug_teardown.closer = NULL;
+	}
+}
+
+static struct ug_module *ug_module_cache_get(const char *name)
+{
+	GSList *list;
+	struct ug_module *module = NULL;
+
+	G_LOCK(ug_cache);
+
+	if (!ug_cache.idle)
+		goto end;
+
+	list = g_hash_table_lookup(ug_cache.idle, name);
+	if (!list)
+		goto end;
+
+	module = list->data;
+	list = g_slist_delete_link(list, list);
+	if (list)
+		g_hash_table_insert(ug_cache.idle, g_strdup(name), list);
+	else
+		g_hash_table_remove(ug_cache.idle, name);
+	g_queue_remove(&ug_cache.lru, module);
+
+ end:
+	G_UNLOCK(ug_cache);
+	return module;
+}
+
+/* removes the least recently used module from the cache, ug_cache locked */
+static struct ug_module *ug_module_cache_pop(void)
+{
+	GSList *list;
+	struct ug_module *module;
+
+	module = g_queue_pop_tail(&ug_cache.lru);
+	if (!module)
+		return NULL;
+
+	list = g_hash_table_lookup(ug_cache.idle, module->module_name);
+	list = g_slist_remove(list, module);
+	if (list)
+		g_hash_table_insert(ug_cache.idle,
+				    g_strdup(module->module_name), list);
+	else
+		g_hash_table_remove(ug_cache.idle, module->module_name);
+
+	return module;
+}
+
+static void ug_module_cache_put(struct ug_module *module)
+{
+	GSList *list;
+	GSList *evicted = NULL;
+
+	G_LOCK(ug_cache);
+
+	if (!ug_cache.idle) {
+		ug_cache.idle = g_hash_table_new_full(g_str_hash, g_str_equal,
+						      g_free, NULL);
+		g_queue_init(&ug_cache.lru);
+	}
+
+	list = g_hash_table_lookup(ug_cache.idle, module->module_name);
+	list = g_slist_prepend(list, module);
+	g_hash_table_insert(ug_cache.idle, g_strdup(module->module_name), list);
+	g_queue_push_head(&ug_cache.lru, module);
+
+	while (g_queue_get_length(&ug_cache.lru) > UG_MODULE_CACHE_MAX)
+		evicted = g_slist_prepend(evicted, ug_module_cache_pop());
+
+	G_UNLOCK(ug_cache);
+
+	while (evicted) {
+		module = evicted->data;
+		_DBG("module cache: evict %s\n", module->module_name);
+		ug_module_free_deferred(module);
+		evicted = g_slist_delete_link(evicted, evicted);
+	}
+}
+
+void ug_module_cache_flush(void)
+{
+	struct ug_module *module;
+
+	while (1) {
+		G_LOCK(ug_cache);
+		module = ug_cache.idle ? ug_module_cache_pop() : NULL;
+		G_UNLOCK(ug_cache);
+
+		if (!module)
 			break;
-	} while (0);
 
+		_DBG("module cache: evict %s\n", module->module_name);
+		ug_module_free_deferred(module);
+	}
+}
+
+struct ug_module *ug_module_open(const char *name)
+{
+	void *handle;
+	struct ug_module *module;
+	char ug_file[PATH_MAX];
+	gint64 t;
+
+	module = ug_module_cache_get(name);
+	if (module) {
+		_DBG("module cache: hit %s\n", name);
+		/* nothing has been loaded this time */
+		memset(module->timing, 0, sizeof(module->timing));
+		return module;
+	}
+
+	/* statically linked modules need no file system access at all */
+	module = ug_module_registry_get(name);
+	if (module)
+		return module;
+
+	if (ug_module_missing_find(name)) {
+		_DBG("module %s is not installed (cached)\n", name);
+		errno = ENOENT;
+		return NULL;
+	}
+
+	module = g_slice_new0(struct ug_module);
+	if (!module) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	t = g_get_monotonic_time();
+	if (ug_module_resolve(name, ug_file, sizeof(ug_file), 1)) {
+		_ERR("module %s is not installed\n", name);
+		ug_module_missing_add(name);
+		errno = ENOENT;
+		goto module_free;
+	}
+
+	module->timing[UG_TIMING_RESOLVE] = g_get_monotonic_time() - t;
+
+	t = g_get_monotonic_time();
 	handle = dlopen(ug_file, RTLD_LAZY);
 	if (!handle) {
 		_ERR("dlopen failed: %s\n", dlerror());
-		goto module_free;
+		if (file_exist(ug_file))
+			goto module_free;
+		/* the index pointed to a removed file, probe directly */
+		ug_module_index_invalidate();
+		if (ug_module_resolve(name, ug_file, sizeof(ug_file), 0)) {
+			ug_module_missing_add(name);
+			errno = ENOENT;
+			goto module_free;
+		}
+		handle = dlopen(ug_file, RTLD_LAZY);
+		if (!handle) {
+			_ERR("dlopen failed: %s\n", dlerror());
+			goto module_free;
+		}
 	}
 
-	module_init = dlsym(handle, UG_MODULE_INIT_SYM);
-	if (!module_init) {
+	module->timing[UG_TIMING_DLOPEN] = g_get_monotonic_time() - t;
+
+	t = g_get_monotonic_time();
+	module->init = dlsym(handle, UG_MODULE_INIT_SYM);
+	module->timing[UG_TIMING_DLSYM] = g_get_monotonic_time() - t;
+	if (!module->init) {
 		_ERR("dlsym failed: %s\n", dlerror());
 		goto module_dlclose;
 	}
 
-	if (module_init(&module->ops))
+	module->module_name = strdup(name);
+	if (!module->module_name) {
+		errno = ENOMEM;
 		goto module_dlclose;
+	}
 
 	module->handle = handle;
 	return module;
@@ -105,29 +554,64 @@ struct ug_module *ug_module_load(const char *name)
 	dlclose(handle);
 
  module_free:
-	free(module);
+	g_slice_free(struct ug_module, module);
 	return NULL;
 }
 
-int ug_module_unload(struct ug_module *module)
+int ug_module_init(struct ug_module *module)
 {
-	void (*module_exit) (struct ug_module_ops *ops);
+	gint64 t;
 
 	if (!module) {
 		errno = EINVAL;
 		return -1;
 	}
 
-	if (module->handle) {
-		module_exit = dlsym(module->handle, UG_MODULE_EXIT_SYM);
-		if (module_exit)
-			module_exit(&module->ops);
-		else
-			_ERR("dlsym failed: %s\n", dlerror());
+	if (module->initted)
+		return 0;
 
-		dlclose(module->handle);
+	t = g_get_monotonic_time();
+	if (module->init(&module->ops)) {
+		_ERR("module %s init failed\n", module->module_name);
+		return -1;
+	}
+	module->timing[UG_TIMING_INIT] = g_get_monotonic_time() - t;
+
+	module->initted = 1;
+	return 0;
+}
+
+struct ug_module *ug_module_load(const char *name)
+{
+	struct ug_module *module;
+
+	module = ug_module_open(name);
+	if (!module)
+		return NULL;
+
+	if (ug_module_init(module)) {
+		ug_module_free(module);
+		return NULL;
+	}
+
+	return module;
+}
+
+void ug_module_drop(struct ug_module *module)
+{
+	/* a module whose init failed must not be handed out again */
+	if (module)
+		ug_module_free(module);
+}
+
+int ug_module_unload(struct ug_module *module)
+{
+	if (!module) {
+		errno = EINVAL;
+		return -1;
 	}
 
-	free(module);
+	/* ops->priv is per instance, a module has one owner at a time */
+	ug_module_cache_put(module);
 	return 0;
 }
@@ -23,6 +23,7 @@
 #include <string.h>
 #include <errno.h>
 #include <stdio.h>
+#include <glib.h>
 
 #include "ug.h"
 #include "ug-module.h"
@@ -33,11 +34,51 @@
 #define UG_API __attribute__ ((visibility("default")))
 #endif
 
+/* number of freed nodes kept before their memory could be reused */
+#define UG_FREE_DELAY 128
+
+/* freed nodes, the oldest first */
+static GQueue ug_freed = G_QUEUE_INIT;
+
+ui_gadget_h ug_alloc(const char *name)
+{
+	ui_gadget_h ug;
+
+	/* nodes come and go with the same size, slices are cheaper */
+	ug = g_slice_new0(struct ui_gadget_s);
+	if (!ug)
+		return NULL;
+
+	if (name) {
+		ug->name = strdup(name);
+		if (!ug->name) {
+			g_slice_free(struct ui_gadget_s, ug);
+			return NULL;
+		}
+	}
+
+	return ug;
+}
+
+/* thread system is initialized by ug_init(), not in main loop callbacks */
+GThreadPool *ug_thread_pool_get(GThreadPool **pool, GFunc func,
+				int max_threads)
+{
+	if (*pool)
+		return *pool;
+
+	*pool = g_thread_pool_new(func, NULL, max_threads, FALSE, NULL);
+	if (!*pool)
+		_ERR("thread pool creation failed\n");
+
+	return *pool;
+}
+
 ui_gadget_h ug_root_create(void)
 {
 	ui_gadget_h ug;
 
-	ug = calloc(1, sizeof(struct ui_gadget_s));
+	ug = ug_alloc(NULL);
 	if (!ug) {
 		_ERR("ug root create failed: Memory allocation failed\n");
 		return NULL;
@@ -45,7 +86,6 @@ ui_gadget_h ug_root_create(void)
 
 	ug->mode = UG_MODE_FULLVIEW;
 	ug->state = UG_STATE_RUNNING;
-	ug->children = NULL;
 
 	return ug;
 }
@@ -64,7 +104,18 @@ int ug_free(ui_gadget_h ug)
 		free((void *)ug->name);
 	if (ug->service)
 		service_destroy(ug->service);
-	free(ug);
+
+	/*
+	 * handles are plain pointers. if the next ug_alloc() got this
+	 * memory back right away, a stale handle would be taken for the
+	 * new gadget, so the node is parked for a while.
+	 */
+	memset(ug, 0, sizeof(struct ui_gadget_s));
+	ug->state = UG_STATE_INVALID;
+	g_queue_push_tail(&ug_freed, ug);
+	if (g_queue_get_length(&ug_freed) > UG_FREE_DELAY)
+		g_slice_free(struct ui_gadget_s, g_queue_pop_head(&ug_freed));
+
 	return 0;
 }
 
@@ -88,6 +139,133 @@ UG_API ui_gadget_h ug_create(ui_gadget_h parent,
 	return ugman_ug_load(parent, name, mode, service, cbs);
 }
 
+UG_API ui_gadget_h ug_create_async(ui_gadget_h parent,
+				   const char *name,
+				   enum ug_mode mode,
+				   service_h service, struct ug_cbs *cbs,
+				   void (*done_cb) (ui_gadget_h ug, void *priv))
+{
+	if (!name) {
+		_ERR("ug_create_async() failed: Invalid name\n");
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (mode < UG_MODE_FULLVIEW || mode >= UG_MODE_INVALID) {
+		_ERR("ug_create_async() failed: Invalid mode\n");
+		errno = EINVAL;
+		return NULL;
+	}
+
+	return ugman_ug_load_async(parent, name, mode, service, cbs, done_cb);
+}
+
+UG_API ug_preload_h ug_preload(const char *name)
+{
+	if (!name) {
+		_ERR("ug_preload() failed: Invalid name\n");
+		errno = EINVAL;
+		return NULL;
+	}
+
+	return ugman_preload(name);
+}
+
+UG_API int ug_preload_release(ug_preload_h preload)
+{
+	if (!preload) {
+		_ERR("ug_preload_release() failed: Invalid preload\n");
+		errno = EINVAL;
+		return -1;
+	}
+
+	return ugman_preload_release(preload);
+}
+
+UG_API int ug_preload_list(const char **names, ug_preload_h *preloads, int n,
+			   void (*done_cb) (void *priv), void *priv)
+{
+	int i;
+
+	if (!names || !preloads || n <= 0) {
+		_ERR("ug_preload_list() failed: Invalid arguments\n");
+		errno = EINVAL;
+		return -1;
+	}
+
+	for (i = 0; i < n; i++) {
+		if (!names[i]) {
+			_ERR("ug_preload_list() failed: Invalid name\n");
+			errno = EINVAL;
+			return -1;
+		}
+	}
+
+	return ugman_preload_list(names, preloads, n, done_cb, priv);
+}
+
+UG_API ui_gadget_h ug_create_preloaded(ui_gadget_h parent,
+				   ug_preload_h preload,
+				   enum ug_mode mode,
+				   service_h service, struct ug_cbs *cbs)
+{
+	if (!preload) {
+		_ERR("ug_create_preloaded() failed: Invalid preload\n");
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (mode < UG_MODE_FULLVIEW || mode >= UG_MODE_INVALID) {
+		_ERR("ug_create_preloaded() failed: Invalid mode\n");
+		errno = EINVAL;
+		return NULL;
+	}
+
+	return ugman_ug_load_preloaded(parent, preload, mode, service, cbs);
+}
+
+UG_API ui_gadget_h ug_prepare(ui_gadget_h parent,
+				   const char *name,
+				   enum ug_mode mode, service_h service)
+{
+	if (!name) {
+		_ERR("ug_prepare() failed: Invalid name\n");
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (mode < UG_MODE_FULLVIEW || mode >= UG_MODE_INVALID) {
+		_ERR("ug_prepare() failed: Invalid mode\n");
+		errno = EINVAL;
+		return NULL;
+	}
+
+	return ugman_ug_prepare(parent, name, mode, service);
+}
+
+UG_API int ug_show_prepared(ui_gadget_h ug, struct ug_cbs *cbs)
+{
+	return ugman_ug_show_prepared(ug, cbs);
+}
+
+UG_API int ug_set_prediction(int enable)
+{
+	return ugman_set_prediction(enable);
+}
+
+UG_API int ug_register_module(const char *name,
+				int (*init) (struct ug_module_ops *ops),
+				void (*exit) (struct ug_module_ops *ops))
+{
+	if (!name || !init) {
+		_ERR("ug_register_module() failed: Invalid arguments\n");
+		errno = EINVAL;
+		return -1;
+	}
+
+	return ug_module_register(name, init, exit);
+}
+
 UG_API int ug_init(Display *disp, Window xid, void *win, enum ug_option opt)
 {
 	if (!win || !xid || !disp) {
@@ -95,7 +273,7 @@ UG_API int ug_init(Display *disp, Window xid, void *win, enum ug_option opt)
 		return -1;
 	}
 
-	if (opt < UG_OPT_INDICATOR_ENABLE || opt >= UG_OPT_MAX) {
+	if (opt & ~(UG_OPT_INDICATOR_MASK | UG_OPT_CREATE_DEFERRED)) {
 		_ERR("ug_init() failed: Invalid option\n");
 		return -1;
 	}
@@ -188,6 +366,11 @@ UG_API void *ug_get_window(void)
 	return ugman_get_window();
 }
 
+UG_API int ug_get_fullview_depth(void)
+{
+	return ugman_get_fullview_depth();
+}
+
 UG_API int ug_send_event(enum ug_event event)
 {
 	if (event <= UG_EVENT_NONE || event >= UG_EVENT_MAX) {
@@ -270,3 +453,20 @@ UG_API int ug_disable_effect(ui_gadget_h ug)
 
 	return 0;
 }
+
+UG_API int ug_get_timing(ui_gadget_h ug, enum ug_timing phase)
+{
+	if (!ug || !ugman_ug_exist(ug)) {
+		_ERR("ug_get_timing() failed: Invalid ug\n");
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (phase < UG_TIMING_RESOLVE || phase >= UG_TIMING_MAX) {
+		_ERR("ug_get_timing() failed: Invalid phase\n");
+		errno = EINVAL;
+		return -1;
+	}
+
+	return ug->timing[phase];
+}
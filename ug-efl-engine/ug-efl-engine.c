@@ -26,6 +26,7 @@
 #include <ui-gadget-engine.h>
 
 #include "ug.h"
+#include "ug-walk.h"
 #include "ug-efl-engine.h"
 #include "ug-dbg.h"
 
@@ -38,6 +39,11 @@ struct cb_data {
 	void(*hide_end_cb)(ui_gadget_h ug);
 };
 
+struct render_data {
+	void (*cb)(void *data);
+	void *data;
+};
+
 
 static void _on_hideonly_cb(void *data, Evas_Object *obj)
 {
@@ -120,22 +126,9 @@ static void _signal_hidealready_finished(void *data, Evas_Object *obj,
 	free(cb_d);
 }
 
-static void _do_destroy(ui_gadget_h ug, ui_gadget_h fv_top)
+static void _do_destroy(ui_gadget_h ug, int depth, void *data)
 {
-	GSList *child;
-	GSList *trail;
-	static int depth = 0;
-
-	if (ug->children) {
-		child = ug->children;
-		while (child) {
-			trail = g_slist_next(child);
-			depth++;
-			_do_destroy(child->data, fv_top);
-			depth--;
-			child = trail;
-		}
-	}
+	ui_gadget_h fv_top = (ui_gadget_h)data;
 
 	_DBG("[UG Effect Plug-in] : start destroy. ug(%p), fv_top(%p),"
 					" depth(%d), layout_state(%d)\n",
@@ -175,7 +168,8 @@ static void on_destroy(ui_gadget_h ug, ui_gadget_h fv_top)
 {
 	if (!ug)
 		return;
-	_do_destroy(ug, fv_top);
+	/* children first */
+	ug_walk(ug, NULL, _do_destroy, fv_top);
 }
 
 static void _signal_show_finished(void *data, Evas_Object *obj,
@@ -265,6 +259,62 @@ static void *on_create(void *win, ui_gadget_h ug,
 	return ly;
 }
 
+static void on_prepare(ui_gadget_h ug)
+{
+	if (!ug || !ug->effect_layout)
+		return;
+
+	/* shown again by on_show_cb() when the layout is shown */
+	evas_object_hide(ug->effect_layout);
+}
+
+static void _on_render_post(void *data, Evas *e, void *event_info)
+{
+	struct render_data *rd = (struct render_data *)data;
+
+	evas_event_callback_del_full(e, EVAS_CALLBACK_RENDER_POST,
+				     _on_render_post, rd);
+	rd->cb(rd->data);
+	free(rd);
+}
+
+static int on_render_post(void *win, void (*cb)(void *data), void *data)
+{
+	struct render_data *rd;
+	Evas *e;
+
+	if (!win || !cb)
+		return -1;
+
+	e = evas_object_evas_get((Evas_Object *) win);
+	if (!e)
+		return -1;
+
+	rd = calloc(1, sizeof(struct render_data));
+	if (!rd)
+		return -1;
+
+	rd->cb = cb;
+	rd->data = data;
+	evas_event_callback_add(e, EVAS_CALLBACK_RENDER_POST,
+				_on_render_post, rd);
+
+	return 0;
+}
+
+static void on_prefetch(const char *file)
+{
+	Eina_List *groups;
+
+	if (!file || !eina_str_has_extension(file, ".edj"))
+		return;
+
+	/* opening the file keeps it in edje file cache for a while */
+	groups = edje_file_collection_list(file);
+	if (groups)
+		edje_file_collection_list_free(groups);
+}
+
 UG_ENGINE_API int UG_ENGINE_INIT(struct ug_engine_ops *ops)
 {
 	if (!ops)
@@ -272,6 +322,9 @@ UG_ENGINE_API int UG_ENGINE_INIT(struct ug_engine_ops *ops)
 
 	ops->create = on_create;
 	ops->destroy = on_destroy;
+	ops->prepare = on_prepare;
+	ops->render_post = on_render_post;
+	ops->prefetch = on_prefetch;
 
 	return 0;
 }